@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -27,13 +27,37 @@ SOURCES += \
         main.cpp \
         view.cpp \
     model.cpp \
-    frame.cpp
+    frame.cpp \
+    pixelbuffer.cpp \
+    pixelcanvas.cpp \
+    dirtyregion.cpp \
+    undostack.cpp \
+    framepool.cpp \
+    ssptextreader.cpp \
+    gifexporter.cpp \
+    spritesheetexporter.cpp \
+    floodfill.cpp \
+    recolor.cpp \
+    rasterizer.cpp \
+    compositor.cpp
 
 HEADERS += \
         view.h \
     model.h \
     frame.h \
-    gif.h
+    gif.h \
+    pixelbuffer.h \
+    pixelcanvas.h \
+    dirtyregion.h \
+    undostack.h \
+    framepool.h \
+    ssptextreader.h \
+    gifexporter.h \
+    spritesheetexporter.h \
+    floodfill.h \
+    recolor.h \
+    rasterizer.h \
+    compositor.h
 
 FORMS += \
         view.ui
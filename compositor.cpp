@@ -0,0 +1,267 @@
+/*
+ * compositor.cpp
+ * An implementation of the Compositor class.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#include "compositor.h"
+#include <algorithm>
+#include <string.h>
+
+//an SSE2 version of the blending is compiled when the target has SSE2 (every x86-64 CPU does)
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static const float INV_255 = 1.0f/255.0f;
+
+/*
+ * returns x/255 rounded to the nearest integer, for x from 0 to 255*255
+*/
+static inline int div255(int x){
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+/*
+ * returns the blend function B of a source and a destination channel (0 to 255) of opaque pixels
+*/
+static inline int blendChannel(int s, int d, int mode){
+    switch(mode){
+        case Compositor::Multiply:
+            return div255(s*d);
+        case Compositor::Screen:
+            return s + d - div255(s*d);
+        case Compositor::Overlay:
+            return (d < 128) ? div255(2*s*d) : 255 - div255(2*(255-s)*(255-d));
+        case Compositor::Darken:
+            return min(s, d);
+        case Compositor::Lighten:
+            return max(s, d);
+        default:
+            return s;
+    }
+}
+
+/*
+ * paints the straight RGBA8 color src over the opaque pixel dest. under an opaque pixel every mode reduces to mixing the
+ * pixel with B by the source alpha, which needs no division, and the pixel stays opaque.
+*/
+static inline void compositeOpaque(const uint8_t* src, uint8_t* dest, int mode){
+    int sa = src[3];
+    for(int i = 0; i < 3; i++){
+        dest[i] = uint8_t(div255(blendChannel(src[i], dest[i], mode)*sa + dest[i]*(255-sa)));
+    }
+}
+
+/*
+ * blends one pixel over another. s and d are premultiplied and hold red, green, blue and alpha from 0 to 1. every mode
+ * is "source over" with a different blend function B: out = s*(1-Da) + d*(1-Sa) + Sa*Da*B. the same formula gives the
+ * right alpha (Sa + Da - Sa*Da) when it is applied to the alpha channel, so all four channels are done alike.
+*/
+static inline void blendPremultiplied(const float s[4], const float d[4], int mode, float out[4]){
+    float sa = s[3];
+    float da = d[3];
+    for(int i = 0; i < 4; i++){
+        float both; //Sa*Da*B, the part where the source and the destination overlap
+        switch(mode){
+            case Compositor::Multiply:
+                both = s[i]*d[i];
+                break;
+            case Compositor::Screen:
+                both = s[i]*da + d[i]*sa - s[i]*d[i];
+                break;
+            case Compositor::Overlay:
+                both = (d[i]+d[i] <= da) ? 2*(s[i]*d[i]) : sa*da - 2*((da-d[i])*(sa-s[i]));
+                break;
+            case Compositor::Darken:
+                both = min(s[i]*da, d[i]*sa);
+                break;
+            case Compositor::Lighten:
+                both = max(s[i]*da, d[i]*sa);
+                break;
+            default:
+                both = s[i]*da;
+                break;
+        }
+        out[i] = both + s[i]*(1-da) + d[i]*(1-sa);
+    }
+}
+
+/*
+ * premultiplies a straight RGBA8 pixel into four floats from 0 to 1
+*/
+static inline void premultiply(const uint8_t* p, float out[4]){
+    float a = float(p[3])*INV_255;
+    for(int i = 0; i < 3; i++){
+        out[i] = (float(p[i])*INV_255)*a;
+    }
+    out[3] = a;
+}
+
+/*
+ * paints src over a pixel, handling every kind of dest. a pixel under a partly transparent destination changes both
+ * color and alpha, so it is premultiplied, blended in float and divided back. a pixel with no alpha left is stored as
+ * 0,0,0,0.
+*/
+static inline void compositePixel(const uint8_t* src, uint8_t* dest, int mode){
+    if(dest[3] == 255){
+        compositeOpaque(src, dest, mode);
+        return;
+    }
+    if(dest[3] == 0){
+        //nothing is under the color, so it is the result whatever the mode
+        if(src[3] == 0){
+            memset(dest, 0, PixelBuffer::BYTES_PER_PIXEL);
+        }
+        else{
+            memcpy(dest, src, PixelBuffer::BYTES_PER_PIXEL);
+        }
+        return;
+    }
+
+    float s[4], d[4], out[4];
+    premultiply(src, s);
+    premultiply(dest, d);
+    blendPremultiplied(s, d, mode, out);
+    if(!(out[3] > 0)){
+        memset(dest, 0, PixelBuffer::BYTES_PER_PIXEL);
+        return;
+    }
+    for(int i = 0; i < 4; i++){
+        float straight = (i == 3) ? out[3] : out[i]/out[3];
+        dest[i] = uint8_t(min(max(int(straight*255.0f + 0.5f), 0), 255));
+    }
+}
+
+#ifdef __SSE2__
+/*
+ * div255 on eight 16 bit lanes
+*/
+static inline __m128i div255SSE2(__m128i x){
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/*
+ * compositeOpaque on two pixels widened to 16 bits a channel. s holds the source channels, s2 twice them, sa the source
+ * alpha and inv 255 minus it, in every lane. the alpha lanes come out wrong and are set to 255 by the caller.
+*/
+static inline __m128i compositeOpaqueSSE2(__m128i d, __m128i s, __m128i s2, __m128i sa, __m128i inv, int mode){
+    const __m128i full = _mm_set1_epi16(255);
+    __m128i blended;
+    switch(mode){
+        case Compositor::Multiply:
+            blended = div255SSE2(_mm_mullo_epi16(s, d));
+            break;
+        case Compositor::Screen:
+            blended = _mm_sub_epi16(_mm_add_epi16(s, d), div255SSE2(_mm_mullo_epi16(s, d)));
+            break;
+        case Compositor::Overlay:{
+            __m128i dark = _mm_cmplt_epi16(d, _mm_set1_epi16(128));
+            __m128i multiplied = div255SSE2(_mm_mullo_epi16(s2, d));
+            __m128i screened = _mm_sub_epi16(full, div255SSE2(_mm_mullo_epi16(_mm_sub_epi16(_mm_add_epi16(full, full), s2),
+                                                                               _mm_sub_epi16(full, d))));
+            blended = _mm_or_si128(_mm_and_si128(dark, multiplied), _mm_andnot_si128(dark, screened));
+            break;
+        }
+        case Compositor::Darken:
+            blended = _mm_min_epi16(s, d);
+            break;
+        case Compositor::Lighten:
+            blended = _mm_max_epi16(s, d);
+            break;
+        default:
+            blended = s;
+            break;
+    }
+    return div255SSE2(_mm_add_epi16(_mm_mullo_epi16(blended, sa), _mm_mullo_epi16(d, inv)));
+}
+#endif
+
+/*
+ * creates a compositor that paints color. its alpha says how much of the color covers the pixels under it.
+*/
+Compositor::Compositor(const QColor& color, BlendMode mode) :
+    word_(PixelBuffer::packColor(color)),
+    mode_(mode){
+    memcpy(color_, &word_, PixelBuffer::BYTES_PER_PIXEL);
+}
+
+/*
+ * returns what a pixel with the raw color dest becomes when it is painted over
+*/
+uint32_t Compositor::composite(uint32_t dest) const{
+    compositeSpan(reinterpret_cast<uint8_t*>(&dest), 1);
+    return dest;
+}
+
+/*
+ * paints over count pixels starting at dest. painting an opaque color normally replaces the pixels and painting a
+ * transparent one normally leaves them alone, so those are done without blending. otherwise, with SSE2, four pixels are
+ * blended at a time in 16 bit integer lanes when each of them is opaque or fully transparent (the pixels of almost every
+ * sprite); a partly transparent pixel among them is finished on its own. both paths round alike, so they give the same
+ * pixels.
+*/
+void Compositor::compositeSpan(uint8_t* dest, int count) const{
+    if(mode_ == Normal && color_[3] == 255){
+        for(int i = 0; i < count; i++){
+            memcpy(dest+i*PixelBuffer::BYTES_PER_PIXEL, &word_, PixelBuffer::BYTES_PER_PIXEL);
+        }
+        return;
+    }
+    if(mode_ == Normal && color_[3] == 0){
+        return;
+    }
+
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32(int(0xff000000u));
+    const __m128i color = _mm_set1_epi32(color_[3] == 0 ? 0 : int(word_)); //what a fully transparent pixel becomes
+    const __m128i s = _mm_unpacklo_epi8(color, zero);
+    const __m128i s2 = _mm_add_epi16(s, s);
+    const __m128i sa = _mm_set1_epi16(color_[3]);
+    const __m128i inv = _mm_set1_epi16(255-color_[3]);
+    for(; i+4 <= count; i += 4){
+        uint8_t* pixels = dest+i*PixelBuffer::BYTES_PER_PIXEL;
+        __m128i p = _mm_loadu_si128((const __m128i*)pixels);
+        __m128i alpha = _mm_and_si128(p, alphaMask);
+        __m128i opaque = _mm_cmpeq_epi32(alpha, alphaMask);
+        __m128i clear = _mm_cmpeq_epi32(alpha, zero);
+
+        __m128i low = compositeOpaqueSSE2(_mm_unpacklo_epi8(p, zero), s, s2, sa, inv, mode_);
+        __m128i high = compositeOpaqueSSE2(_mm_unpackhi_epi8(p, zero), s, s2, sa, inv, mode_);
+        __m128i painted = _mm_or_si128(_mm_packus_epi16(low, high), alphaMask);
+        __m128i result = _mm_or_si128(_mm_or_si128(_mm_and_si128(opaque, painted), _mm_and_si128(clear, color)),
+                                      _mm_andnot_si128(_mm_or_si128(opaque, clear), p));
+        _mm_storeu_si128((__m128i*)pixels, result);
+
+        int partial = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(opaque, clear))) & 0xf;
+        for(int lane = 0; partial != 0; lane++, partial >>= 1){
+            if(partial & 1){
+                compositePixel(color_, pixels+lane*PixelBuffer::BYTES_PER_PIXEL, mode_);
+            }
+        }
+    }
+#endif
+    for(; i < count; i++){
+        compositePixel(color_, dest+i*PixelBuffer::BYTES_PER_PIXEL, mode_);
+    }
+}
+
+/*
+ * paints over the pixels of every span. a pixel in two spans would be painted twice, so the spans must not overlap.
+*/
+void Compositor::paintSpans(PixelBuffer& pixels, const vector<PixelSpan>& spans) const{
+    for(const PixelSpan& span : spans){
+        compositeSpan(pixels.scanLine(span.row)+span.left*PixelBuffer::BYTES_PER_PIXEL, span.right-span.left);
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ * compositor.h
+ * The Compositor class paints a color over pixels the way a translucent brush does, instead of replacing them: the
+ * color is mixed with what is already there according to its alpha and a blend mode (normal "source over", multiply,
+ * screen, overlay, darken or lighten), following the W3C compositing spec. Frames keep straight (not premultiplied)
+ * RGBA8 pixels. Over an opaque pixel the formulas need no division, so those pixels (and fully transparent ones, which
+ * just take the color) are blended in integer RGBA8, four at a time with SSE2. Partly transparent pixels are
+ * premultiplied, blended in float and divided back. The SSE2 and scalar versions round alike, so both give the same
+ * pixels.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <QColor>
+#include <vector>
+#include <stdint.h>
+#include "pixelbuffer.h"
+
+using namespace std;
+
+class Compositor{
+public:
+    enum BlendMode{
+        Normal, //the color over the pixel
+        Multiply, //darkens by multiplying the channels
+        Screen, //lightens by multiplying the inverted channels
+        Overlay, //multiplies dark pixels and screens light ones
+        Darken, //keeps the darker of each channel
+        Lighten //keeps the lighter of each channel
+    };
+
+    Compositor(const QColor& color, BlendMode mode = Normal); //paints color with the given blend mode
+
+    uint32_t composite(uint32_t dest) const; //the raw color (see PixelBuffer::word) of a pixel after painting over it
+    void compositeSpan(uint8_t* dest, int count) const; //paints over count pixels in a row, in place
+    void paintSpans(PixelBuffer& pixels, const vector<PixelSpan>& spans) const; //paints over every pixel of the spans (which must not overlap)
+
+private:
+    uint8_t color_[PixelBuffer::BYTES_PER_PIXEL]; //straight RGBA8 color being painted
+    uint32_t word_; //the same color as a raw value
+    BlendMode mode_; //how the color mixes with the pixels under it
+};
+
+#endif // COMPOSITOR_H
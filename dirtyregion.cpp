@@ -0,0 +1,66 @@
+/*
+ * dirtyregion.cpp
+ * An implementation of the DirtyRegion class.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#include "dirtyregion.h"
+
+/*
+ * creates an empty region for an image with the given number of columns and rows
+*/
+DirtyRegion::DirtyRegion(int width, int height) :
+    width_(width),
+    height_(height),
+    marked_(width*height, false){
+
+}
+
+/*
+ * starts tracking an image of a different size. any marked pixels are forgotten.
+*/
+void DirtyRegion::resize(int width, int height){
+    width_ = width;
+    height_ = height;
+    marked_.assign(width*height, false);
+    pixels_.clear();
+    bounds_ = QRect();
+}
+
+/*
+ * adds a pixel to the region if it is not already in it
+*/
+void DirtyRegion::mark(int row, int col){
+    int index = row*width_+col;
+    if(marked_[index]){
+        return;
+    }
+    marked_[index] = true;
+    pixels_.push_back(index);
+    bounds_ = bounds_.united(QRect(col, row, 1, 1));
+}
+
+/*
+ * returns true if the pixel has been marked since the region was last cleared
+*/
+bool DirtyRegion::contains(int row, int col) const{
+    return marked_[row*width_+col];
+}
+
+/*
+ * empties the region. only the flags of the marked pixels are reset, so this is as cheap as the region is small.
+*/
+void DirtyRegion::clear(){
+    for(int index : pixels_){
+        marked_[index] = false;
+    }
+    pixels_.clear();
+    bounds_ = QRect();
+}
@@ -0,0 +1,46 @@
+/*
+ * dirtyregion.h
+ * The DirtyRegion class keeps track of which pixels of an image have changed since they were last saved. It stores
+ * the changed pixels in the order they were marked along with their bounding rectangle, so saving or repainting the
+ * changes costs time proportional to the number of changed pixels instead of the size of the image.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#ifndef DIRTYREGION_H
+#define DIRTYREGION_H
+
+#include <QRect>
+#include <vector>
+
+using namespace std;
+
+class DirtyRegion{
+public:
+    DirtyRegion(int width = 0, int height = 0); //creates an empty region for an image of the given size
+
+    void resize(int width, int height); //changes the size of the image being tracked and clears the region
+    void mark(int row, int col); //marks a pixel as changed (marking a pixel more than once has no effect)
+    bool contains(int row, int col) const; //true if the pixel has been marked since the last clear
+    bool isEmpty() const {return pixels_.empty();}
+    void clear(); //unmarks every pixel
+
+    int width() const {return width_;}
+    const vector<int>& pixels() const {return pixels_;} //indices (row*width+col) of the changed pixels in the order they were marked
+    QRect bounds() const {return bounds_;} //smallest rectangle containing every changed pixel (x is the column, y is the row)
+
+private:
+    int width_; //number of columns in the image
+    int height_; //number of rows in the image
+    vector<bool> marked_; //one flag per pixel, true if the pixel is in pixels_
+    vector<int> pixels_; //changed pixels
+    QRect bounds_; //bounding rectangle of pixels_
+};
+
+#endif // DIRTYREGION_H
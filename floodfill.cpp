@@ -0,0 +1,139 @@
+/*
+ * floodfill.cpp
+ * An implementation of the FloodFill class.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#include "floodfill.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * returns the raw color of the pixel in column col of a row returned by PixelBuffer::constScanLine
+*/
+static inline uint32_t wordAt(const uint8_t* line, int col){
+    uint32_t value;
+    memcpy(&value, line+col*PixelBuffer::BYTES_PER_PIXEL, PixelBuffer::BYTES_PER_PIXEL);
+    return value;
+}
+
+/*
+ * creates a fill over the top left size x size pixels of the buffer. the buffer is only read, and it must outlive the fill.
+*/
+FloodFill::FloodFill(const PixelBuffer& pixels, int size) :
+    pixels_(pixels),
+    size_(size),
+    tolerance_(0),
+    diagonal_(false),
+    target_(0),
+    wordsPerRow_((size+63)/64){
+
+}
+
+/*
+ * returns true if a pixel with the raw color word is close enough to the clicked color to be filled
+*/
+inline bool FloodFill::matches(uint32_t word) const{
+    if(word == target_){
+        return true;
+    }
+    if(tolerance_ == 0){
+        return false;
+    }
+    //the same shift picks the same channel out of both words, whatever the byte order
+    for(int shift = 0; shift < 32; shift += 8){
+        if(abs(int((word >> shift) & 0xff) - int((target_ >> shift) & 0xff)) > tolerance_){
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * sets the visited bits of the pixels of a row from left up to (not including) right, a word at a time
+*/
+void FloodFill::markVisited(int row, int left, int right){
+    uint64_t* bits = visited_.data() + row*wordsPerRow_;
+    for(int col = left; col < right;){
+        int bit = col & 63;
+        int count = min(64-bit, right-col);
+        uint64_t mask = (count == 64) ? ~uint64_t(0) : ((uint64_t(1) << count) - 1);
+        bits[col >> 6] |= mask << bit;
+        col += count;
+    }
+}
+
+/*
+ * scans the pixels of a row from left up to (not including) right and adds a seed at the start of each run of
+ * pixels that match and have not been filled yet
+*/
+void FloodFill::findSeeds(int row, int left, int right){
+    const uint8_t* line = pixels_.constScanLine(row);
+    int col = left;
+    while(col < right){
+        if(isVisited(row, col) || !matches(wordAt(line, col))){
+            col++;
+            continue;
+        }
+        seeds_.push_back({row, col, col+1});
+        while(col < right && !isVisited(row, col) && matches(wordAt(line, col))){
+            col++;
+        }
+    }
+}
+
+/*
+ * finds every pixel connected to (row, col) through pixels that match its color, and returns them as spans. each
+ * seed is grown into the widest span of matching pixels around it, then the rows above and below the span are
+ * searched for new seeds. since a span always reaches pixels that do not match (or the edge) on both sides, a pixel
+ * next to a span is never part of another span in the same row, so only the seeds need to check the bitmap.
+*/
+const vector<PixelSpan>& FloodFill::fill(int row, int col){
+    spans_.clear();
+    seeds_.clear();
+    if(row < 0 || col < 0 || row >= size_ || col >= size_){
+        return spans_;
+    }
+    visited_.assign(wordsPerRow_*size_, 0);
+    target_ = pixels_.word(row, col);
+    seeds_.push_back({row, col, col+1});
+
+    while(!seeds_.empty()){
+        PixelSpan seed = seeds_.back();
+        seeds_.pop_back();
+        if(isVisited(seed.row, seed.left)){
+            continue; //another span already took this seed
+        }
+
+        const uint8_t* line = pixels_.constScanLine(seed.row);
+        int left = seed.left;
+        int right = seed.left+1;
+        while(left > 0 && matches(wordAt(line, left-1))){
+            left--;
+        }
+        while(right < size_ && matches(wordAt(line, right))){
+            right++;
+        }
+        markVisited(seed.row, left, right);
+        spans_.push_back({seed.row, left, right});
+
+        //diagonal neighbours touch the span from one column further out on each side
+        int searchLeft = diagonal_ ? max(left-1, 0) : left;
+        int searchRight = diagonal_ ? min(right+1, size_) : right;
+        if(seed.row > 0){
+            findSeeds(seed.row-1, searchLeft, searchRight);
+        }
+        if(seed.row+1 < size_){
+            findSeeds(seed.row+1, searchLeft, searchRight);
+        }
+    }
+    return spans_;
+}
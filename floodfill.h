@@ -0,0 +1,54 @@
+/*
+ * floodfill.h
+ * The FloodFill class finds the area the fill tool paints. It works on the raw words of a PixelBuffer one row at a
+ * time: each step grows a horizontal run of matching pixels as far as it goes, then looks for runs to grow in the rows
+ * above and below it. The pixels already taken are kept in a packed bitmap (one bit per pixel), so the fill takes time
+ * proportional to the filled area, and it returns the area as a list of spans that can be painted in one go.
+ * A tolerance lets colors close to the clicked one be filled too, and diagonal neighbours can be included.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#ifndef FLOODFILL_H
+#define FLOODFILL_H
+
+#include <vector>
+#include <stdint.h>
+#include "pixelbuffer.h"
+
+using namespace std;
+
+class FloodFill{
+public:
+    FloodFill(const PixelBuffer& pixels, int size); //fills within the top left size x size pixels of the buffer
+
+    void setTolerance(int tolerance) {tolerance_ = tolerance;} //largest difference in any channel from the clicked color that is still filled (0 by default, exact matches only)
+    void setDiagonal(bool enabled) {diagonal_ = enabled;} //true to spread to diagonal neighbours as well (off by default)
+
+    const vector<PixelSpan>& fill(int row, int col); //finds the area connected to a pixel. the spans do not overlap
+
+private:
+    bool matches(uint32_t word) const; //true if a pixel of this color is filled
+    bool isVisited(int row, int col) const {return (visited_[row*wordsPerRow_ + (col>>6)] >> (col&63)) & 1;}
+    void markVisited(int row, int left, int right); //sets the bits of the pixels from left up to (not including) right
+    void findSeeds(int row, int left, int right); //adds a seed for every run of unvisited matching pixels in [left, right)
+
+    const PixelBuffer& pixels_; //pixels being filled
+    int size_; //number of rows (columns) of the area being filled
+    int tolerance_; //largest channel difference that is filled
+    bool diagonal_; //true for 8-connectivity
+    uint32_t target_; //raw color of the clicked pixel
+
+    int wordsPerRow_; //64 bit words of the visited bitmap in each row
+    vector<uint64_t> visited_; //one bit per pixel, set once the pixel is part of a span
+    vector<PixelSpan> seeds_; //runs still to be grown (only row and left are used)
+    vector<PixelSpan> spans_; //the filled area
+};
+
+#endif // FLOODFILL_H
@@ -12,26 +12,65 @@
 */
 
 #include "frame.h"
+#include <utility>
 
 using namespace std;
 
 /*
- * create a new frame with a 2d vector if pixels
+ * the pixels of a frame live as long as the frame (or the undo history) needs them, so they come from the frame pool
 */
-Frame::Frame(vector<vector<QColor>> pixels){
-    pixels_ = pixels;
+FrameData::FrameData(const PixelBuffer& pixels) : pixels(pixels, &FramePool::instance()){
+
+}
+
+/*
+ * takes over pixels that were made in the frame pool without copying them. other pixels are copied into it.
+*/
+FrameData::FrameData(PixelBuffer&& pixels) :
+    pixels(pixels.pool() == &FramePool::instance() ? move(pixels) : PixelBuffer(pixels, &FramePool::instance())){
+
+}
+
+/*
+ * copies another frame's pixels into the frame pool
+*/
+FrameData::FrameData(const FrameData& other) :
+    QSharedData(other),
+    pixels(other.pixels, &FramePool::instance()){
+
+}
+
+/*
+ * create a frame with an empty buffer of pixels
+*/
+Frame::Frame() : d_(new FrameData(PixelBuffer())), duration_(0){
+
+}
+
+/*
+ * create a new frame with a copy of a buffer of pixels
+*/
+Frame::Frame(const PixelBuffer& pixels) : d_(new FrameData(pixels)), duration_(0){
+
+}
+
+/*
+ * create a new frame that takes ownership of a buffer of pixels
+*/
+Frame::Frame(PixelBuffer&& pixels) : d_(new FrameData(move(pixels))), duration_(0){
+
 }
 
 /*
- * returns the 2d vector of pixels associated with the frame
+ * copies a new buffer of pixels into the frame. other copies of the frame keep the old pixels.
 */
-vector<vector<QColor>> Frame::getPixels(){
-    return pixels_;
+void Frame::saveFrame(const PixelBuffer& currentFrame){
+    d_=new FrameData(currentFrame);
 }
 
 /*
- * saves a new 2d vector of pixels for the frame
+ * moves a new buffer of pixels into the frame. other copies of the frame keep the old pixels.
 */
-void Frame::saveFrame(vector<vector<QColor>> currentFrame){
-    pixels_=currentFrame;
+void Frame::saveFrame(PixelBuffer&& currentFrame){
+    d_=new FrameData(move(currentFrame));
 }
@@ -1,6 +1,10 @@
 /*
  * frame.h
- * The Frame class stores the individual pixles (QColors) that make up each frame in the sprite animation sequence.
+ * The Frame class stores the individual pixles that make up each frame in the sprite animation sequence in a PixelBuffer.
+ * Pixels are read through a const reference and edited in place so that no caller has to copy a whole frame.
+ * Frames are implicitly shared (copy-on-write): copying a Frame only copies a reference to its pixels, and the pixels
+ * are duplicated the first time one of the copies is edited. This lets the undo history keep old versions of the
+ * project without copying frames that did not change.
  *
  * Kira Parker
  * Torin McDonald
@@ -12,19 +16,50 @@
 #ifndef FRAME_H
 #define FRAME_H
 
-#include <QTableWidgetItem>
+#include <QColor>
+#include <QSharedData>
+#include <QSharedDataPointer>
 #include<vector>
+#include "pixelbuffer.h"
+#include "framepool.h"
 
 using namespace std;
 
+/*
+ * the shared part of a frame
+*/
+class FrameData : public QSharedData{
+public:
+    FrameData(const PixelBuffer& pixels); //copies the pixels into the frame pool
+    FrameData(PixelBuffer&& pixels); //takes over pixels that are already in the frame pool, or copies them there
+    FrameData(const FrameData& other); //copies the pixels into the frame pool (when a shared frame is edited)
+
+    //the shared parts of frames come from the frame pool like their pixels
+    static void* operator new(size_t size) {return FramePool::instance().allocate(size);}
+    static void operator delete(void* block, size_t size) {FramePool::instance().release(block, size);}
+
+    PixelBuffer pixels; //stores the colors for each frame (i.e. pixels)
+};
+
 class Frame{
 public:
-    Frame(vector<vector<QColor>> pixels); //creates a new frame with the given 2d vector of pixels
-    vector<vector<QColor>> getPixels(); //gets the 2d vector of pixels for the frame
-    void saveFrame(vector<vector<QColor>> currentFrame); //saves a new 2d vector of pixels for the current frame
+    Frame(); //creates a frame with no pixels
+    Frame(const PixelBuffer& pixels); //creates a new frame with a copy of the given buffer of pixels
+    Frame(PixelBuffer&& pixels); //creates a new frame that takes over the given buffer of pixels without copying it
+    const PixelBuffer& pixels() const {return d_->pixels;} //read-only view of the pixels of the frame
+    PixelBuffer& editPixels() {return d_->pixels;} //the pixels of the frame, for changing them in place (unshares them first)
+    QColor pixel(int row, int col) const {return d_->pixels.pixel(row, col);} //gets the color of one pixel
+    void setPixel(int row, int col, const QColor& color) {d_->pixels.setPixel(row, col, color);} //sets the color of one pixel
+    void saveFrame(const PixelBuffer& currentFrame); //copies a new buffer of pixels into the frame
+    void saveFrame(PixelBuffer&& currentFrame); //moves a new buffer of pixels into the frame
+    int duration() const {return duration_;} //milliseconds the frame is shown for, or 0 to use the playback speed
+    void setDuration(int duration) {duration_ = duration;} //sets how long the frame is shown for (0 for the playback speed)
+
+    const void* version() const {return d_.constData();} //two frames with the same version share the same pixels
 
 private:
-    vector<vector<QColor>> pixels_; //stores the colors for each frame (i.e. pixels)
+    QSharedDataPointer<FrameData> d_; //pixels, possibly shared with other copies of this frame
+    int duration_; //milliseconds the frame is shown for in the animation, or 0 to use the playback speed
 };
 
 #endif // FRAME_H
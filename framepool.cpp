@@ -0,0 +1,122 @@
+/*
+ * framepool.cpp
+ * An implementation of the FramePool class.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#include "framepool.h"
+#include <QMutexLocker>
+#include <algorithm>
+
+/*
+ * returns the pool shared by all frames. it is created the first time it is needed.
+*/
+FramePool& FramePool::instance(){
+    static FramePool pool;
+    return pool;
+}
+
+/*
+ * creates an empty pool. no memory is reserved until the first block is requested.
+*/
+FramePool::FramePool(){
+
+}
+
+/*
+ * rounds a request up to a multiple of BLOCK_ALIGNMENT so that every block in a chunk stays aligned
+*/
+size_t FramePool::roundUp(size_t bytes){
+    if(bytes == 0){
+        bytes = 1;
+    }
+    return (bytes+BLOCK_ALIGNMENT-1)/BLOCK_ALIGNMENT*BLOCK_ALIGNMENT;
+}
+
+/*
+ * returns the chunk that block was cut from: the one that starts at the highest address not above it
+*/
+FramePool::Chunk& FramePool::chunkOf(void* block){
+    map<uint8_t*, Chunk>::iterator chunk = chunks_.upper_bound(static_cast<uint8_t*>(block));
+    --chunk;
+    return chunk->second;
+}
+
+/*
+ * returns a block of at least the given number of bytes. a released block of the same size is reused if there is one,
+ * otherwise the block is cut from the newest chunk of that size (reserving a new chunk when it is used up).
+*/
+void* FramePool::allocate(size_t bytes){
+    size_t blockSize = roundUp(bytes);
+    QMutexLocker locker(&mutex_);
+    SizeClass& sizeClass = sizeClasses_[blockSize];
+
+    if(!sizeClass.freeBlocks.empty()){
+        void* block = sizeClass.freeBlocks.back();
+        sizeClass.freeBlocks.pop_back();
+        chunkOf(block).blocksInUse += 1;
+        return block;
+    }
+
+    if(sizeClass.untouched == 0){
+        //operator new[] returns memory aligned for any type, which is at least BLOCK_ALIGNMENT on the platforms we build for
+        size_t blockCount = sizeClass.chunkBlocks;
+        uint8_t* memory = new uint8_t[blockSize*blockCount];
+        Chunk& chunk = chunks_[memory];
+        chunk.memory.reset(memory);
+        chunk.blockSize = blockSize;
+        chunk.blockCount = blockCount;
+        chunk.blocksInUse = 0;
+        sizeClass.next = memory;
+        sizeClass.untouched = blockCount;
+        sizeClass.chunkBlocks = (blockCount*2 < MAX_CHUNK_BLOCKS) ? blockCount*2 : MAX_CHUNK_BLOCKS;
+        sizeClass.chunkCount += 1;
+    }
+    void* block = sizeClass.next;
+    sizeClass.next += blockSize;
+    sizeClass.untouched -= 1;
+    chunkOf(block).blocksInUse += 1;
+    return block;
+}
+
+/*
+ * puts a block back on the free list of its size. bytes must be the size that was passed to allocate. when the last
+ * block of a chunk comes back, the chunk is given back to the heap instead, along with its blocks on the free list.
+*/
+void FramePool::release(void* block, size_t bytes){
+    if(block == nullptr){
+        return;
+    }
+    size_t blockSize = roundUp(bytes);
+    QMutexLocker locker(&mutex_);
+    SizeClass& sizeClass = sizeClasses_[blockSize];
+
+    Chunk& chunk = chunkOf(block);
+    chunk.blocksInUse -= 1;
+    if(chunk.blocksInUse > 0){
+        sizeClass.freeBlocks.push_back(block);
+        return;
+    }
+
+    uint8_t* begin = chunk.memory.get();
+    uint8_t* end = begin + chunk.blockSize*chunk.blockCount;
+    sizeClass.freeBlocks.erase(remove_if(sizeClass.freeBlocks.begin(), sizeClass.freeBlocks.end(), [=](void* freeBlock){
+        return static_cast<uint8_t*>(freeBlock) >= begin && static_cast<uint8_t*>(freeBlock) < end;
+    }), sizeClass.freeBlocks.end());
+    if(sizeClass.untouched > 0 && sizeClass.next >= begin && sizeClass.next < end){
+        sizeClass.next = nullptr;
+        sizeClass.untouched = 0;
+    }
+    chunks_.erase(begin);
+    sizeClass.chunkCount -= 1;
+    if(sizeClass.chunkCount == 0){
+        sizeClasses_.erase(blockSize); //a size that is used again starts over with a small chunk
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ * framepool.h
+ * The FramePool class hands out the memory used for frames. Frames in a project all have the same size, so instead of
+ * asking the heap for every new frame, copy or undo snapshot, the pool carves fixed-size blocks out of large chunks and
+ * keeps the blocks of freed frames on a free list to reuse them for the next frame of the same size. A chunk is given
+ * back to the heap as soon as none of its blocks are in use, so sizes that were only needed for a while (a frame size
+ * the user tried and left) do not keep memory reserved.
+ * Only the frames of the project (and of the undo history, which holds frames) use the pool. PoolAllocator lets the
+ * pixel data of a PixelBuffer come from the pool when it is asked to and from the heap otherwise, so the temporary
+ * buffers made by exports, fills and the preview do not wait on the pool's lock or fill it with one-off sizes.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <QMutex>
+#include <map>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+using namespace std;
+
+class FramePool{
+public:
+    static const size_t BLOCK_ALIGNMENT = 16; //every block starts on a multiple of this many bytes
+    static const size_t FIRST_CHUNK_BLOCKS = 4; //number of blocks in the first chunk of a size. each new chunk of that size holds twice as many
+    static const size_t MAX_CHUNK_BLOCKS = 64; //the most blocks a chunk holds
+
+    static FramePool& instance(); //the pool shared by all frames
+
+    void* allocate(size_t bytes); //gets a block of at least the given number of bytes
+    void release(void* block, size_t bytes); //gives back a block returned by allocate(bytes) so it can be reused
+
+private:
+    FramePool();
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    /*
+     * the blocks of one size
+    */
+    struct SizeClass{
+        vector<void*> freeBlocks; //released blocks, ready to be handed out again
+        uint8_t* next = nullptr; //next block in the newest chunk that has never been handed out
+        size_t untouched = 0; //number of blocks left after next in the newest chunk
+        size_t chunkBlocks = FIRST_CHUNK_BLOCKS; //number of blocks in the next chunk that is reserved
+        size_t chunkCount = 0; //number of chunks of this size
+    };
+
+    /*
+     * memory taken from the heap for blocks of one size
+    */
+    struct Chunk{
+        unique_ptr<uint8_t[]> memory;
+        size_t blockSize; //size of each block
+        size_t blockCount; //number of blocks
+        size_t blocksInUse; //number of blocks handed out and not yet released
+    };
+
+    static size_t roundUp(size_t bytes); //block size used for a request of the given size
+    Chunk& chunkOf(void* block); //the chunk a block was cut from
+
+    mutable QMutex mutex_; //frames are created and freed on the gui thread and on worker threads
+    map<size_t, SizeClass> sizeClasses_; //blocks, by block size
+    map<uint8_t*, Chunk> chunks_; //all memory taken from the heap, by the address it starts at
+};
+
+/*
+ * an allocator for standard containers that takes its memory from a FramePool, or from the heap if it has none. a
+ * copy of a container starts out on the heap, while a container that is moved keeps its memory (and its pool).
+*/
+template <typename T>
+class PoolAllocator{
+public:
+    typedef T value_type;
+    typedef true_type propagate_on_container_move_assignment;
+    typedef true_type propagate_on_container_swap;
+
+    PoolAllocator(FramePool* pool = nullptr) : pool_(pool){}
+    template <typename U> PoolAllocator(const PoolAllocator<U>& other) : pool_(other.pool()){}
+
+    T* allocate(size_t n){
+        return static_cast<T*>(pool_ ? pool_->allocate(n*sizeof(T)) : ::operator new(n*sizeof(T)));
+    }
+    void deallocate(T* p, size_t n){
+        if(pool_){
+            pool_->release(p, n*sizeof(T));
+        }
+        else{
+            ::operator delete(p);
+        }
+    }
+    PoolAllocator select_on_container_copy_construction() const {return PoolAllocator();} //copies are temporary unless they are made for a frame
+
+    FramePool* pool() const {return pool_;}
+
+private:
+    FramePool* pool_; //pool the memory comes from, or nullptr for the heap
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>& a, const PoolAllocator<U>& b) {return a.pool() == b.pool();}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>& a, const PoolAllocator<U>& b) {return a.pool() != b.pool();}
+
+#endif // FRAMEPOOL_H
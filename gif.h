@@ -14,10 +14,15 @@
 // So resulting files are often quite large. The hope is that it will be handy nonetheless
 // as a quick and easily-integrated way for programs to spit out animations.
 //
-// Only RGBA8 is currently supported as an input format. (The alpha is ignored.)
+// Only RGBA8 is currently supported as an input format. Pixels with an alpha below the
+// alphaThreshold passed to GifWriteFrame are written as transparent (palette index 0), and the
+// rest are opaque. A frame whose pixels turn transparent in the next frame is written with
+// disposal method 2 so it is cleared before the next one is drawn. (A threshold of 0 makes every
+// pixel opaque.)
 //
 // USAGE:
 // Create a GifWriter struct. Pass it to GifBegin() to initialize and write the header.
+// (or to GifBeginWithSink() to receive the GIF through a callback, e.g. into memory)
 // Pass subsequent frames to GifWriteFrame().
 // Finally, call GifEnd() to close the file handle and free memory.
 //
@@ -29,6 +34,13 @@
 #include <string.h>  // for memcpy and bzero
 #include <stdint.h>  // for integer typedefs
 
+// SSE2/AVX2 versions of the palette search are compiled on x86 with gcc and clang and picked at run time
+// if the CPU supports them. Everything else uses the scalar version.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define GIF_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
 // Define these macros to hook into a custom memory allocator.
 // TEMP_MALLOC and TEMP_FREE will only be called in stack fashion - frees in the reverse order of mallocs
 // and any temp memory allocated by a function will be freed before it exits.
@@ -57,6 +69,30 @@
 
 const int kGifTransIndex = 0;
 
+// Pixels whose alpha is below a threshold are transparent in the GIF (a threshold of 0 makes every
+// pixel opaque). Before a frame is palettized its pixels are copied with GifNormalizePixel, which
+// reduces their alpha to 0 (transparent, and black, so all transparent pixels are alike) or 255,
+// and from then on two pixels are the same if all four of their channels are.
+void GifNormalizePixel( const uint8_t* pixel, uint8_t* dest, int alphaThreshold )
+{
+    if( pixel[3] < alphaThreshold )
+    {
+        dest[0] = dest[1] = dest[2] = dest[3] = 0;
+    }
+    else
+    {
+        dest[0] = pixel[0];
+        dest[1] = pixel[1];
+        dest[2] = pixel[2];
+        dest[3] = 255;
+    }
+}
+
+bool GifSamePixel( const uint8_t* a, const uint8_t* b )
+{
+    return a[0] == b[0] && a[1] == b[1] && a[2] == b[2] && a[3] == b[3];
+}
+
 struct GifPalette
 {
     int bitDepth;
@@ -64,12 +100,6 @@ struct GifPalette
     uint8_t r[256];
     uint8_t g[256];
     uint8_t b[256];
-    
-    // k-d tree over RGB space, organized in heap fashion
-    // i.e. left child of node i is node i*2, right child is node i*2+1
-    // nodes 256-511 are implicitly the leaves, containing a color
-    uint8_t treeSplitElt[255];
-    uint8_t treeSplit[255];
 };
 
 // max, min, and abs functions
@@ -77,56 +107,170 @@ int GifIMax(int l, int r) { return l>r?l:r; }
 int GifIMin(int l, int r) { return l<r?l:r; }
 int GifIAbs(int i) { return i<0?-i:i; }
 
-// walks the k-d tree to pick the palette entry for a desired color.
-// Takes as in/out parameters the current best color and its error -
-// only changes them if it finds a better color in its subtree.
-// this is the major hotspot in the code at the moment.
-void GifGetClosestPaletteColor(GifPalette* pPal, int r, int g, int b, int& bestInd, int& bestDiff, int treeRoot = 1)
+// Finds the nearest palette color with a brute force search over the whole palette, which
+// vectorizes well and, unlike walking a k-d tree, does not branch on the data. A small cache
+// of recent colors answers most lookups without any search, since pixel art reuses a
+// handful of colors.
+// The distance is the sum of the absolute differences of the channels, and ties go to
+// the lowest index, so every version of the search picks the same color.
+
+const int kGifCacheSize = 4096;              // entries in the color cache (a power of two)
+const int16_t kGifUnusedColor = 2000;        // channel value of palette slots that must never be picked
+
+struct GifColorMatcher
+{
+    // the palette with one array per channel. the transparent entry and the padding up to
+    // count hold kGifUnusedColor, which is further from any real color than every real entry
+    int16_t r[256];
+    int16_t g[256];
+    int16_t b[256];
+    int count;                               // number of entries to search, a multiple of 16
+    
+    uint32_t cacheKey[kGifCacheSize];        // 0x01RRGGBB for a cached color, 0 for an empty slot
+    uint8_t cacheIndex[kGifCacheSize];       // palette index of the cached color
+};
+
+int GifNearestScalar( const GifColorMatcher* m, int r, int g, int b )
 {
-    // base case, reached the bottom of the tree
-    if(treeRoot > (1<<pPal->bitDepth)-1)
+    int bestInd = 0;
+    int bestDiff = 1000000;
+    for( int ii=0; ii<m->count; ++ii )
     {
-        int ind = treeRoot-(1<<pPal->bitDepth);
-        if(ind == kGifTransIndex) return;
-        
-        // check whether this color is better than the current winner
-        int r_err = r - ((int32_t)pPal->r[ind]);
-        int g_err = g - ((int32_t)pPal->g[ind]);
-        int b_err = b - ((int32_t)pPal->b[ind]);
-        int diff = GifIAbs(r_err)+GifIAbs(g_err)+GifIAbs(b_err);
-        
-        if(diff < bestDiff)
+        int diff = GifIAbs(m->r[ii]-r) + GifIAbs(m->g[ii]-g) + GifIAbs(m->b[ii]-b);
+        if( diff < bestDiff )
         {
-            bestInd = ind;
             bestDiff = diff;
+            bestInd = ii;
         }
+    }
+    return bestInd;
+}
+
+#ifdef GIF_X86_SIMD
+// picks the lane with the lowest difference (and the lowest index on ties)
+int GifPickBestLane( const int16_t* diffs, const int16_t* indices, int lanes )
+{
+    int best = 0;
+    for( int ii=1; ii<lanes; ++ii )
+    {
+        if( diffs[ii] < diffs[best] || (diffs[ii] == diffs[best] && indices[ii] < indices[best]) )
+            best = ii;
+    }
+    return indices[best];
+}
+
+__attribute__((target("sse2")))
+int GifNearestSSE2( const GifColorMatcher* m, int r, int g, int b )
+{
+    const __m128i vr = _mm_set1_epi16((int16_t)r);
+    const __m128i vg = _mm_set1_epi16((int16_t)g);
+    const __m128i vb = _mm_set1_epi16((int16_t)b);
+    const __m128i step = _mm_set1_epi16(8);
+    __m128i index = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+    __m128i best = _mm_set1_epi16(0x7fff);
+    __m128i bestIndex = _mm_setzero_si128();
+    
+    for( int ii=0; ii<m->count; ii+=8 )
+    {
+        __m128i dr = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(m->r+ii)), vr);
+        __m128i dg = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(m->g+ii)), vg);
+        __m128i db = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(m->b+ii)), vb);
+        // SSE2 has no abs, but |x| = max(x, -x)
+        dr = _mm_max_epi16(dr, _mm_sub_epi16(_mm_setzero_si128(), dr));
+        dg = _mm_max_epi16(dg, _mm_sub_epi16(_mm_setzero_si128(), dg));
+        db = _mm_max_epi16(db, _mm_sub_epi16(_mm_setzero_si128(), db));
+        __m128i diff = _mm_add_epi16(_mm_add_epi16(dr, dg), db);
         
-        return;
+        // strictly smaller, so each lane keeps its earliest best index
+        __m128i smaller = _mm_cmpgt_epi16(best, diff);
+        best = _mm_min_epi16(best, diff);
+        bestIndex = _mm_or_si128(_mm_and_si128(smaller, index), _mm_andnot_si128(smaller, bestIndex));
+        index = _mm_add_epi16(index, step);
     }
     
-    // take the appropriate color (r, g, or b) for this node of the k-d tree
-    int comps[3]; comps[0] = r; comps[1] = g; comps[2] = b;
-    int splitComp = comps[pPal->treeSplitElt[treeRoot]];
-    
-    int splitPos = pPal->treeSplit[treeRoot];
-    if(splitPos > splitComp)
+    int16_t diffs[8], indices[8];
+    _mm_storeu_si128((__m128i*)diffs, best);
+    _mm_storeu_si128((__m128i*)indices, bestIndex);
+    return GifPickBestLane(diffs, indices, 8);
+}
+
+__attribute__((target("avx2")))
+int GifNearestAVX2( const GifColorMatcher* m, int r, int g, int b )
+{
+    const __m256i vr = _mm256_set1_epi16((int16_t)r);
+    const __m256i vg = _mm256_set1_epi16((int16_t)g);
+    const __m256i vb = _mm256_set1_epi16((int16_t)b);
+    const __m256i step = _mm256_set1_epi16(16);
+    __m256i index = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m256i best = _mm256_set1_epi16(0x7fff);
+    __m256i bestIndex = _mm256_setzero_si256();
+    
+    for( int ii=0; ii<m->count; ii+=16 )
     {
-        // check the left subtree
-        GifGetClosestPaletteColor(pPal, r, g, b, bestInd, bestDiff, treeRoot*2);
-        if( bestDiff > splitPos - splitComp )
-        {
-            // cannot prove there's not a better value in the right subtree, check that too
-            GifGetClosestPaletteColor(pPal, r, g, b, bestInd, bestDiff, treeRoot*2+1);
-        }
+        __m256i dr = _mm256_abs_epi16(_mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)(m->r+ii)), vr));
+        __m256i dg = _mm256_abs_epi16(_mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)(m->g+ii)), vg));
+        __m256i db = _mm256_abs_epi16(_mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)(m->b+ii)), vb));
+        __m256i diff = _mm256_add_epi16(_mm256_add_epi16(dr, dg), db);
+        
+        __m256i smaller = _mm256_cmpgt_epi16(best, diff);
+        best = _mm256_min_epi16(best, diff);
+        bestIndex = _mm256_blendv_epi8(bestIndex, index, smaller);
+        index = _mm256_add_epi16(index, step);
     }
-    else
+    
+    int16_t diffs[16], indices[16];
+    _mm256_storeu_si256((__m256i*)diffs, best);
+    _mm256_storeu_si256((__m256i*)indices, bestIndex);
+    return GifPickBestLane(diffs, indices, 16);
+}
+#endif
+
+typedef int (*GifNearestFunc)( const GifColorMatcher* m, int r, int g, int b );
+
+// picks the fastest search the CPU supports
+GifNearestFunc GifSelectNearest()
+{
+#ifdef GIF_X86_SIMD
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports("avx2") ) return GifNearestAVX2;
+    if( __builtin_cpu_supports("sse2") ) return GifNearestSSE2;
+#endif
+    return GifNearestScalar;
+}
+
+// the search picked for this CPU, chosen the first time it is needed
+GifNearestFunc GifNearest()
+{
+    static const GifNearestFunc nearest = GifSelectNearest();
+    return nearest;
+}
+
+// sets up the matcher for a new palette and empties its cache
+void GifMatcherInit( GifColorMatcher* m, const GifPalette* pPal )
+{
+    int numColors = 1 << pPal->bitDepth;
+    m->count = (numColors+15) & ~15;
+    for( int ii=0; ii<256; ++ii )
     {
-        GifGetClosestPaletteColor(pPal, r, g, b, bestInd, bestDiff, treeRoot*2+1);
-        if( bestDiff > splitComp - splitPos )
-        {
-            GifGetClosestPaletteColor(pPal, r, g, b, bestInd, bestDiff, treeRoot*2);
-        }
+        bool used = ii < numColors && ii != kGifTransIndex;
+        m->r[ii] = used? pPal->r[ii] : kGifUnusedColor;
+        m->g[ii] = used? pPal->g[ii] : kGifUnusedColor;
+        m->b[ii] = used? pPal->b[ii] : kGifUnusedColor;
     }
+    memset(m->cacheKey, 0, sizeof(m->cacheKey));
+}
+
+// returns the index of the palette color nearest to r, g, b (each 0 to 255)
+int GifMatcherFind( GifColorMatcher* m, int r, int g, int b )
+{
+    uint32_t key = 0x01000000u | (r << 16) | (g << 8) | b;
+    uint32_t slot = (key * 2654435761u) >> 20;  // top 12 bits of a multiplicative hash
+    if( m->cacheKey[slot] == key ) return m->cacheIndex[slot];
+    
+    int ind = GifNearest()(m, r, g, b);
+    m->cacheKey[slot] = key;
+    m->cacheIndex[slot] = (uint8_t)ind;
+    return ind;
 }
 
 void GifSwapPixels(uint8_t* image, int pixA, int pixB)
@@ -200,7 +344,7 @@ void GifPartitionByMedian(uint8_t* image, int left, int right, int com, int need
 }
 
 // Builds a palette by creating a balanced k-d tree of all pixels in the image
-void GifSplitPalette(uint8_t* image, int numPixels, int firstElt, int lastElt, int splitElt, int splitDist, int treeNode, bool buildForDither, GifPalette* pal)
+void GifSplitPalette(uint8_t* image, int numPixels, int firstElt, int lastElt, int splitElt, int splitDist, bool buildForDither, GifPalette* pal)
 {
     if(lastElt <= firstElt || numPixels == 0)
         return;
@@ -308,17 +452,14 @@ void GifSplitPalette(uint8_t* image, int numPixels, int firstElt, int lastElt, i
     
     GifPartitionByMedian(image, 0, numPixels, splitCom, subPixelsA);
     
-    pal->treeSplitElt[treeNode] = splitCom;
-    pal->treeSplit[treeNode] = image[subPixelsA*4+splitCom];
-    
-    GifSplitPalette(image,              subPixelsA, firstElt, splitElt, splitElt-splitDist, splitDist/2, treeNode*2,   buildForDither, pal);
-    GifSplitPalette(image+subPixelsA*4, subPixelsB, splitElt, lastElt,  splitElt+splitDist, splitDist/2, treeNode*2+1, buildForDither, pal);
+    GifSplitPalette(image,              subPixelsA, firstElt, splitElt, splitElt-splitDist, splitDist/2, buildForDither, pal);
+    GifSplitPalette(image+subPixelsA*4, subPixelsB, splitElt, lastElt,  splitElt+splitDist, splitDist/2, buildForDither, pal);
 }
 
-// Finds all pixels that have changed from the previous image and
-// moves them to the fromt of th buffer.
+// Finds all opaque pixels that have changed from the previous image (all opaque pixels
+// if there is none) and moves them to the fromt of th buffer.
 // This allows us to build a palette optimized for the colors of the
-// changed pixels only.
+// changed pixels only. Transparent pixels need no color.
 int GifPickChangedPixels( const uint8_t* lastFrame, uint8_t* frame, int numPixels )
 {
     int numChanged = 0;
@@ -326,9 +467,7 @@ int GifPickChangedPixels( const uint8_t* lastFrame, uint8_t* frame, int numPixel
     
     for (int ii=0; ii<numPixels; ++ii)
     {
-        if(lastFrame[0] != frame[0] ||
-           lastFrame[1] != frame[1] ||
-           lastFrame[2] != frame[2])
+        if(frame[3] != 0 && !(lastFrame && GifSamePixel(lastFrame, frame)))
         {
             writeIter[0] = frame[0];
             writeIter[1] = frame[1];
@@ -336,7 +475,7 @@ int GifPickChangedPixels( const uint8_t* lastFrame, uint8_t* frame, int numPixel
             ++numChanged;
             writeIter += 4;
         }
-        lastFrame += 4;
+        if(lastFrame) lastFrame += 4;
         frame += 4;
     }
     
@@ -345,44 +484,47 @@ int GifPickChangedPixels( const uint8_t* lastFrame, uint8_t* frame, int numPixel
 
 // Creates a palette by placing all the image pixels in a k-d tree and then averaging the blocks at the bottom.
 // This is known as the "modified median split" technique
-void GifMakePalette( const uint8_t* lastFrame, const uint8_t* nextFrame, uint32_t width, uint32_t height, int bitDepth, bool buildForDither, GifPalette* pPal )
+// destroyableImage is scratch memory of at least width*height*4 bytes that is overwritten.
+void GifMakePalette( const uint8_t* lastFrame, const uint8_t* nextFrame, uint32_t width, uint32_t height, int bitDepth, bool buildForDither, GifPalette* pPal, uint8_t* destroyableImage )
 {
     pPal->bitDepth = bitDepth;
     
     // SplitPalette is destructive (it sorts the pixels by color) so
     // we must create a copy of the image for it to destroy
     int imageSize = width*height*4*sizeof(uint8_t);
-    uint8_t* destroyableImage = (uint8_t*)GIF_TEMP_MALLOC(imageSize);
     memcpy(destroyableImage, nextFrame, imageSize);
     
-    int numPixels = width*height;
-    if(lastFrame)
-        numPixels = GifPickChangedPixels(lastFrame, destroyableImage, numPixels);
+    int numPixels = GifPickChangedPixels(lastFrame, destroyableImage, width*height);
     
     const int lastElt = 1 << bitDepth;
     const int splitElt = lastElt/2;
     const int splitDist = splitElt/2;
     
-    GifSplitPalette(destroyableImage, numPixels, 1, lastElt, splitElt, splitDist, 1, buildForDither, pPal);
-    
-    GIF_TEMP_FREE(destroyableImage);
+    // leaves that get no pixels are never set by SplitPalette. give them a color that is in the
+    // image so the brute force search in GifMatcherFind cannot pick a made up color
+    if( numPixels > 0 )
+    {
+        memset(pPal->r, destroyableImage[0], sizeof(pPal->r));
+        memset(pPal->g, destroyableImage[1], sizeof(pPal->g));
+        memset(pPal->b, destroyableImage[2], sizeof(pPal->b));
+    }
     
-    // add the bottom node for the transparency index
-    pPal->treeSplit[1 << (bitDepth-1)] = 0;
-    pPal->treeSplitElt[1 << (bitDepth-1)] = 0;
+    GifSplitPalette(destroyableImage, numPixels, 1, lastElt, splitElt, splitDist, buildForDither, pPal);
     
+    // index 0 is the transparency index
     pPal->r[0] = pPal->g[0] = pPal->b[0] = 0;
 }
 
 // Implements Floyd-Steinberg dithering, writes palette value to alpha
-void GifDitherImage( const uint8_t* lastFrame, const uint8_t* nextFrame, uint8_t* outFrame, uint32_t width, uint32_t height, GifPalette* pPal )
+// quantPixels is working memory for width*height*4 values (see GifScratchQuantPixels)
+void GifDitherImage( const uint8_t* lastFrame, const uint8_t* nextFrame, uint8_t* outFrame, uint32_t width, uint32_t height, GifPalette* pPal, GifColorMatcher* matcher, int32_t* quantPixels )
 {
     int numPixels = width*height;
+    GifMatcherInit(matcher, pPal);
     
     // quantPixels initially holds color*256 for all pixels
     // The extra 8 bits of precision allow for sub-single-color error values
     // to be propagated
-    int32_t* quantPixels = (int32_t*)GIF_TEMP_MALLOC(sizeof(int32_t)*numPixels*4);
     
     for( int ii=0; ii<numPixels*4; ++ii )
     {
@@ -403,9 +545,18 @@ void GifDitherImage( const uint8_t* lastFrame, const uint8_t* nextFrame, uint8_t
             int32_t gg = (nextPix[1] + 127) / 256;
             int32_t bb = (nextPix[2] + 127) / 256;
             
+            // transparent pixels take no part in the dithering
+            if( nextFrame[4*(yy*width+xx)+3] == 0 )
+            {
+                nextPix[0] = nextPix[1] = nextPix[2] = 0;
+                nextPix[3] = kGifTransIndex;
+                continue;
+            }
+            
             // if it happens that we want the color from last frame, then just write out
             // a transparent pixel
             if( lastFrame &&
+               lastPix[3] != 0 &&
                lastPix[0] == rr &&
                lastPix[1] == gg &&
                lastPix[2] == bb )
@@ -417,11 +568,8 @@ void GifDitherImage( const uint8_t* lastFrame, const uint8_t* nextFrame, uint8_t
                 continue;
             }
             
-            int32_t bestDiff = 1000000;
-            int32_t bestInd = kGifTransIndex;
-            
             // Search the palete
-            GifGetClosestPaletteColor(pPal, rr, gg, bb, bestInd, bestDiff);
+            int32_t bestInd = GifMatcherFind(matcher, GifIMin(rr, 255), GifIMin(gg, 255), GifIMin(bb, 255));
             
             // Write the result to the temp buffer
             int32_t r_err = nextPix[0] - int32_t(pPal->r[bestInd]) * 256;
@@ -479,34 +627,34 @@ void GifDitherImage( const uint8_t* lastFrame, const uint8_t* nextFrame, uint8_t
     {
         outFrame[ii] = quantPixels[ii];
     }
-    
-    GIF_TEMP_FREE(quantPixels);
 }
 
 // Picks palette colors for the image using simple thresholding, no dithering
-void GifThresholdImage( const uint8_t* lastFrame, const uint8_t* nextFrame, uint8_t* outFrame, uint32_t width, uint32_t height, GifPalette* pPal )
+void GifThresholdImage( const uint8_t* lastFrame, const uint8_t* nextFrame, uint8_t* outFrame, uint32_t width, uint32_t height, GifPalette* pPal, GifColorMatcher* matcher )
 {
     uint32_t numPixels = width*height;
+    GifMatcherInit(matcher, pPal);
     for( uint32_t ii=0; ii<numPixels; ++ii )
     {
         // if a previous color is available, and it matches the current color,
         // set the pixel to transparent
-        if(lastFrame &&
-           lastFrame[0] == nextFrame[0] &&
-           lastFrame[1] == nextFrame[1] &&
-           lastFrame[2] == nextFrame[2])
+        if(lastFrame && GifSamePixel(lastFrame, nextFrame))
         {
             outFrame[0] = lastFrame[0];
             outFrame[1] = lastFrame[1];
             outFrame[2] = lastFrame[2];
             outFrame[3] = kGifTransIndex;
         }
+        else if(nextFrame[3] == 0)
+        {
+            // a transparent pixel
+            outFrame[0] = outFrame[1] = outFrame[2] = 0;
+            outFrame[3] = kGifTransIndex;
+        }
         else
         {
             // palettize the pixel
-            int32_t bestDiff = 1000000;
-            int32_t bestInd = 1;
-            GifGetClosestPaletteColor(pPal, nextFrame[0], nextFrame[1], nextFrame[2], bestInd, bestDiff);
+            int32_t bestInd = GifMatcherFind(matcher, nextFrame[0], nextFrame[1], nextFrame[2]);
             
             // Write the resulting color to the output buffer
             outFrame[0] = pPal->r[bestInd];
@@ -521,6 +669,183 @@ void GifThresholdImage( const uint8_t* lastFrame, const uint8_t* nextFrame, uint
     }
 }
 
+// Exact palettes. Sprites rarely use more than 255 colors; when the pixels of a frame (or of
+// the whole animation) fit, every color gets its own palette entry and the pixels are mapped
+// with a hash lookup. That is faster than building a median split palette, and lossless.
+
+const int kGifExactSize = 1024;  // slots in the hash table of an exact palette (a power of two, 4x the colors it holds)
+
+struct GifExactTable
+{
+    uint32_t key[kGifExactSize];    // 0x01RRGGBB, or 0 for an empty slot
+    uint8_t index[kGifExactSize];   // palette index of the color in the slot
+    uint8_t r[256];                 // colors by palette index (entry 0 is the transparent color)
+    uint8_t g[256];
+    uint8_t b[256];
+    int count;                      // number of colors, palette entries 1 to count
+};
+
+void GifExactInit( GifExactTable* t )
+{
+    memset(t->key, 0, sizeof(t->key));
+    t->count = 0;
+}
+
+// first slot to look at for a color
+uint32_t GifExactSlot( uint32_t key )
+{
+    return (key * 2654435761u) >> 22;  // top 10 bits of a multiplicative hash
+}
+
+// returns the palette index of a color, or -1 if it is not in the table
+int GifExactFind( const GifExactTable* t, uint8_t r, uint8_t g, uint8_t b )
+{
+    uint32_t key = 0x01000000u | (r << 16) | (g << 8) | b;
+    for( uint32_t slot = GifExactSlot(key); t->key[slot]; slot = (slot+1) & (kGifExactSize-1) )
+    {
+        if( t->key[slot] == key ) return t->index[slot];
+    }
+    return -1;
+}
+
+// adds a color to the table if it is new. returns false if the table already holds 255 colors
+bool GifExactAdd( GifExactTable* t, uint8_t r, uint8_t g, uint8_t b )
+{
+    uint32_t key = 0x01000000u | (r << 16) | (g << 8) | b;
+    uint32_t slot = GifExactSlot(key);
+    for( ; t->key[slot]; slot = (slot+1) & (kGifExactSize-1) )
+    {
+        if( t->key[slot] == key ) return true;
+    }
+    if( t->count == 255 ) return false;
+    
+    int ind = ++t->count;
+    t->key[slot] = key;
+    t->index[slot] = (uint8_t)ind;
+    t->r[ind] = r;
+    t->g[ind] = g;
+    t->b[ind] = b;
+    return true;
+}
+
+// adds the colors of the opaque pixels of nextFrame that differ from lastFrame (every opaque pixel if lastFrame is NULL).
+// returns false as soon as there are too many colors for one palette.
+bool GifExactAddImage( GifExactTable* t, const uint8_t* lastFrame, const uint8_t* nextFrame, uint32_t numPixels )
+{
+    for( uint32_t ii=0; ii<numPixels; ++ii, nextFrame += 4 )
+    {
+        if( lastFrame )
+        {
+            bool same = GifSamePixel(lastFrame, nextFrame);
+            lastFrame += 4;
+            if( same ) continue;
+        }
+        if( nextFrame[3] == 0 ) continue;
+        if( !GifExactAdd(t, nextFrame[0], nextFrame[1], nextFrame[2]) ) return false;
+    }
+    return true;
+}
+
+// makes the palette of the table, with the smallest bit depth that holds it
+void GifExactMakePalette( const GifExactTable* t, GifPalette* pPal )
+{
+    int bitDepth = 2;  // LZW codes in a GIF are at least 2 bits
+    while( (1 << bitDepth) < t->count+1 ) ++bitDepth;
+    
+    pPal->bitDepth = bitDepth;
+    memset(pPal->r, 0, sizeof(pPal->r));
+    memset(pPal->g, 0, sizeof(pPal->g));
+    memset(pPal->b, 0, sizeof(pPal->b));
+    for( int ii=1; ii<=t->count; ++ii )
+    {
+        pPal->r[ii] = t->r[ii];
+        pPal->g[ii] = t->g[ii];
+        pPal->b[ii] = t->b[ii];
+    }
+}
+
+// like GifThresholdImage, but every changed pixel is looked up in the table its palette was made from
+void GifExactMapImage( const uint8_t* lastFrame, const uint8_t* nextFrame, uint8_t* outFrame, uint32_t numPixels, const GifExactTable* t )
+{
+    for( uint32_t ii=0; ii<numPixels; ++ii )
+    {
+        if(lastFrame && GifSamePixel(lastFrame, nextFrame))
+        {
+            outFrame[0] = lastFrame[0];
+            outFrame[1] = lastFrame[1];
+            outFrame[2] = lastFrame[2];
+            outFrame[3] = kGifTransIndex;
+        }
+        else if(nextFrame[3] == 0)
+        {
+            outFrame[0] = outFrame[1] = outFrame[2] = 0;
+            outFrame[3] = kGifTransIndex;
+        }
+        else
+        {
+            int ind = GifExactFind(t, nextFrame[0], nextFrame[1], nextFrame[2]);
+            if( ind < 0 ) ind = 1;  // cannot happen when the table was filled from this frame
+            
+            outFrame[0] = nextFrame[0];
+            outFrame[1] = nextFrame[1];
+            outFrame[2] = nextFrame[2];
+            outFrame[3] = (uint8_t)ind;
+        }
+        
+        if(lastFrame) lastFrame += 4;
+        outFrame += 4;
+        nextFrame += 4;
+    }
+}
+
+// Growable block of memory that an encoded frame is written into. Frames are encoded into
+// their own buffers (possibly on different threads) and the buffers are written to the file in order.
+struct GifBuffer
+{
+    uint8_t* data;
+    uint32_t size;      // bytes written so far
+    uint32_t capacity;  // bytes allocated
+};
+
+void GifBufferInit( GifBuffer* buf )
+{
+    buf->data = NULL;
+    buf->size = 0;
+    buf->capacity = 0;
+}
+
+void GifBufferFree( GifBuffer* buf )
+{
+    GIF_FREE(buf->data);
+    GifBufferInit(buf);
+}
+
+// append count bytes, growing the buffer geometrically when it is full
+void GifBufferWrite( GifBuffer* buf, const void* bytes, uint32_t count )
+{
+    if( buf->size + count > buf->capacity )
+    {
+        uint32_t newCapacity = buf->capacity? buf->capacity*2 : 4096;
+        while( newCapacity < buf->size + count ) newCapacity *= 2;
+        
+        uint8_t* newData = (uint8_t*)GIF_MALLOC(newCapacity);
+        if( buf->size ) memcpy(newData, buf->data, buf->size);
+        GIF_FREE(buf->data);
+        buf->data = newData;
+        buf->capacity = newCapacity;
+    }
+    memcpy(buf->data + buf->size, bytes, count);
+    buf->size += count;
+}
+
+void GifBufferPut( GifBuffer* buf, uint8_t byte )
+{
+    if( buf->size < buf->capacity )
+        buf->data[buf->size++] = byte;
+    else
+        GifBufferWrite(buf, &byte, 1);
+}
+
 // Simple structure to write out the LZW-compressed portion of the image
 // one bit at a time
 struct GifBitStatus
@@ -550,18 +875,18 @@ void GifWriteBit( GifBitStatus& stat, uint32_t bit )
     }
 }
 
-// write all bytes so far to the file
-void GifWriteChunk( FILE* f, GifBitStatus& stat )
+// write all bytes so far to the buffer
+void GifWriteChunk( GifBuffer* f, GifBitStatus& stat )
 {
-    fputc(stat.chunkIndex, f);
-    fwrite(stat.chunk, 1, stat.chunkIndex, f);
+    GifBufferPut(f, stat.chunkIndex);
+    GifBufferWrite(f, stat.chunk, stat.chunkIndex);
     
     stat.bitIndex = 0;
     stat.byte = 0;
     stat.chunkIndex = 0;
 }
 
-void GifWriteCode( FILE* f, GifBitStatus& stat, uint32_t code, uint32_t length )
+void GifWriteCode( GifBuffer* f, GifBitStatus& stat, uint32_t code, uint32_t length )
 {
     for( uint32_t ii=0; ii<length; ++ii )
     {
@@ -582,12 +907,12 @@ struct GifLzwNode
     uint16_t m_next[256];
 };
 
-// write a 256-color (8-bit) image palette to the file
-void GifWritePalette( const GifPalette* pPal, FILE* f )
+// write a 256-color (8-bit) image palette to the buffer
+void GifWritePalette( const GifPalette* pPal, GifBuffer* f )
 {
-    fputc(0, f);  // first color: transparency
-    fputc(0, f);
-    fputc(0, f);
+    GifBufferPut(f, 0);  // first color: transparency
+    GifBufferPut(f, 0);
+    GifBufferPut(f, 0);
     
     for(int ii=1; ii<(1 << pPal->bitDepth); ++ii)
     {
@@ -595,51 +920,207 @@ void GifWritePalette( const GifPalette* pPal, FILE* f )
         uint32_t g = pPal->g[ii];
         uint32_t b = pPal->b[ii];
         
-        fputc(r, f);
-        fputc(g, f);
-        fputc(b, f);
+        GifBufferPut(f, r);
+        GifBufferPut(f, g);
+        GifBufferPut(f, b);
+    }
+}
+
+// Memory an encoder reuses from frame to frame instead of allocating it for every frame.
+// One encoder (a GifWriter, or one thread of a parallel export) owns each GifScratch.
+struct GifScratch
+{
+    GifLzwNode* codetree;       // 4096 nodes. all zero between frames; only the nodes a frame used are cleared after it
+    uint8_t* image;             // working copy of a frame for GifMakePalette
+    uint8_t* quantized;         // palettized frame (only the changed rectangle of it, when it was cropped)
+    uint8_t* croppedLast;       // changed rectangle of the previous frame, normalized
+    uint8_t* croppedNext;       // changed rectangle of the frame being encoded, normalized
+    uint32_t imageCapacity;     // bytes allocated for each of the frame buffers
+    int32_t* quantPixels;       // dithering error of each channel, allocated the first time a frame is dithered
+    uint32_t quantCapacity;     // number of values quantPixels has room for
+    uint32_t left, top;         // rectangle of the last frame encoded, in canvas space
+    uint32_t width, height;
+    int disposal;               // disposal method of the last frame encoded: 1 leaves it in place, 2 clears it
+    GifColorMatcher matcher;    // palette search for the frame being palettized
+    GifExactTable exact;        // colors of the frame being palettized, when it has few enough of them
+};
+
+void GifScratchInit( GifScratch* scratch )
+{
+    scratch->codetree = (GifLzwNode*)GIF_MALLOC(sizeof(GifLzwNode)*4096);
+    memset(scratch->codetree, 0, sizeof(GifLzwNode)*4096);
+    scratch->image = NULL;
+    scratch->quantized = NULL;
+    scratch->croppedLast = NULL;
+    scratch->croppedNext = NULL;
+    scratch->imageCapacity = 0;
+    scratch->quantPixels = NULL;
+    scratch->quantCapacity = 0;
+}
+
+void GifScratchFree( GifScratch* scratch )
+{
+    GIF_FREE(scratch->codetree);
+    GIF_FREE(scratch->image);
+    GIF_FREE(scratch->quantized);
+    GIF_FREE(scratch->croppedLast);
+    GIF_FREE(scratch->croppedNext);
+    GIF_FREE(scratch->quantPixels);
+    scratch->codetree = NULL;
+    scratch->image = NULL;
+    scratch->quantized = NULL;
+    scratch->croppedLast = NULL;
+    scratch->croppedNext = NULL;
+    scratch->imageCapacity = 0;
+    scratch->quantPixels = NULL;
+    scratch->quantCapacity = 0;
+}
+
+// make sure the frame buffers can hold a width x height frame. they only grow.
+void GifScratchReserve( GifScratch* scratch, uint32_t width, uint32_t height )
+{
+    uint32_t imageSize = width*height*4;
+    if( imageSize <= scratch->imageCapacity ) return;
+    
+    GIF_FREE(scratch->image);
+    GIF_FREE(scratch->quantized);
+    GIF_FREE(scratch->croppedLast);
+    GIF_FREE(scratch->croppedNext);
+    scratch->image = (uint8_t*)GIF_MALLOC(imageSize);
+    scratch->quantized = (uint8_t*)GIF_MALLOC(imageSize);
+    scratch->croppedLast = (uint8_t*)GIF_MALLOC(imageSize);
+    scratch->croppedNext = (uint8_t*)GIF_MALLOC(imageSize);
+    scratch->imageCapacity = imageSize;
+}
+
+// returns room for the dithering error of a width x height frame. it only grows.
+int32_t* GifScratchQuantPixels( GifScratch* scratch, uint32_t width, uint32_t height )
+{
+    uint32_t count = width*height*4;
+    if( count > scratch->quantCapacity )
+    {
+        GIF_FREE(scratch->quantPixels);
+        scratch->quantPixels = (int32_t*)GIF_MALLOC(sizeof(int32_t)*count);
+        scratch->quantCapacity = count;
     }
+    return scratch->quantPixels;
 }
 
-// write the image header, LZW-compress and write out the image
-void GifWriteLzwImage(FILE* f, uint8_t* image, uint32_t left, uint32_t top,  uint32_t width, uint32_t height, uint32_t delay, GifPalette* pPal)
+// Gets a frame ready to be palettized, in a single pass over its pixels: the frame (and lastFrame, if there
+// is one) are copied into scratch with GifNormalizePixel, the rectangle around the pixels that differ from
+// lastFrame is found, and the frame is checked for pixels that turn transparent after lastFrame or before
+// followingFrame (NULL for the last frame).
+// A transparent pixel leaves the frame under it showing, so a pixel can only turn transparent if the frame
+// before it is disposed of (restored to the transparent background) once its time is up. Such a frame
+// covers the whole canvas, and the frame after it is encoded on its own, as if it were the first.
+// Sets the rectangle and disposal method of the frame in scratch, and *last and *next to its cropped pixels
+// (*last is NULL when the frame does not depend on the one before it).
+// Returns false if the frame is the same as lastFrame and does not need to be encoded at all.
+bool GifPrepareFrame( const uint8_t* lastFrame, const uint8_t* image, const uint8_t* followingFrame, uint32_t width, uint32_t height,
+                      int alphaThreshold, GifScratch* scratch, const uint8_t** last, const uint8_t** next )
 {
-    // graphics control extension
-    fputc(0x21, f);
-    fputc(0xf9, f);
-    fputc(0x04, f);
-    fputc(0x05, f); // leave prev frame in place, this frame has transparency
-    fputc(delay & 0xff, f);
-    fputc((delay >> 8) & 0xff, f);
-    fputc(kGifTransIndex, f); // transparent color index
-    fputc(0, f);
+    GifScratchReserve(scratch, width, height);
     
-    fputc(0x2c, f); // image descriptor block
+    uint8_t* lastOut = scratch->croppedLast;
+    uint8_t* nextOut = scratch->croppedNext;
+    bool changed = false, clearsBefore = false, clearsAfter = false;
+    uint32_t minX = width, minY = height, maxX = 0, maxY = 0;
+    for( uint32_t yy=0; yy<height; ++yy )
+    {
+        for( uint32_t xx=0; xx<width; ++xx )
+        {
+            uint32_t ii = (yy*width+xx)*4;
+            GifNormalizePixel(image+ii, nextOut+ii, alphaThreshold);
+            bool opaque = nextOut[ii+3] != 0;
+            if( opaque && followingFrame && followingFrame[ii+3] < alphaThreshold ) clearsAfter = true;
+            
+            if( !lastFrame ) continue;
+            GifNormalizePixel(lastFrame+ii, lastOut+ii, alphaThreshold);
+            if( GifSamePixel(lastOut+ii, nextOut+ii) ) continue;
+            
+            changed = true;
+            if( !opaque ) clearsBefore = true;
+            if( xx < minX ) minX = xx;
+            if( xx > maxX ) maxX = xx;
+            if( yy < minY ) minY = yy;
+            maxY = yy;
+        }
+    }
     
-    fputc(left & 0xff, f);           // corner of image in canvas space
-    fputc((left >> 8) & 0xff, f);
-    fputc(top & 0xff, f);
-    fputc((top >> 8) & 0xff, f);
+    scratch->disposal = clearsAfter? 2 : 1;
+    scratch->left = scratch->top = 0;
+    scratch->width = width;
+    scratch->height = height;
+    *last = (lastFrame && !clearsBefore)? lastOut : NULL;
+    *next = nextOut;
+    if( !*last || clearsAfter ) return true;
+    if( !changed ) return false;
+    
+    scratch->left = minX;
+    scratch->top = minY;
+    scratch->width = maxX+1 - minX;
+    scratch->height = maxY+1 - minY;
+    
+    // move the rows of the rectangle to the front of the buffers (each row only moves back, so this works in place)
+    uint32_t rowSize = scratch->width*4;
+    for( uint32_t yy=0; yy<scratch->height; ++yy )
+    {
+        uint32_t from = ((minY+yy)*width + minX)*4;
+        memmove(lastOut + yy*rowSize, lastOut + from, rowSize);
+        memmove(nextOut + yy*rowSize, nextOut + from, rowSize);
+    }
+    return true;
+}
+
+// graphics control extension of a frame. the delay is filled in when the frame is written, since a frame
+// lasts longer when the frames after it are the same and are left out of the file
+void GifWriteGraphicsControl( GifBuffer* f, uint32_t delay, int disposal )
+{
+    GifBufferPut(f, 0x21);
+    GifBufferPut(f, 0xf9);
+    GifBufferPut(f, 0x04);
+    GifBufferPut(f, (disposal << 2) | 0x01); // what happens to the frame after it is shown, this frame has transparency
+    GifBufferPut(f, delay & 0xff);
+    GifBufferPut(f, (delay >> 8) & 0xff);
+    GifBufferPut(f, kGifTransIndex); // transparent color index
+    GifBufferPut(f, 0);
+}
+
+// write the image descriptor, LZW-compress and write out the image (the graphics control extension comes separately)
+// codetree must be all zero (as GifScratchInit leaves it); it is all zero again when this returns.
+// localPalette is false for images that use the global color table, which must then be pPal.
+void GifWriteLzwImage(GifBuffer* f, uint8_t* image, uint32_t left, uint32_t top,  uint32_t width, uint32_t height, const GifPalette* pPal, GifLzwNode* codetree, bool localPalette = true)
+{
+    GifBufferPut(f, 0x2c); // image descriptor block
     
-    fputc(width & 0xff, f);          // width and height of image
-    fputc((width >> 8) & 0xff, f);
-    fputc(height & 0xff, f);
-    fputc((height >> 8) & 0xff, f);
+    GifBufferPut(f, left & 0xff);           // corner of image in canvas space
+    GifBufferPut(f, (left >> 8) & 0xff);
+    GifBufferPut(f, top & 0xff);
+    GifBufferPut(f, (top >> 8) & 0xff);
     
-    //fputc(0, f); // no local color table, no transparency
-    //fputc(0x80, f); // no local color table, but transparency
+    GifBufferPut(f, width & 0xff);          // width and height of image
+    GifBufferPut(f, (width >> 8) & 0xff);
+    GifBufferPut(f, height & 0xff);
+    GifBufferPut(f, (height >> 8) & 0xff);
     
-    fputc(0x80 + pPal->bitDepth-1, f); // local color table present, 2 ^ bitDepth entries
-    GifWritePalette(pPal, f);
+    //GifBufferPut(f, 0); // no local color table, no transparency
+    //GifBufferPut(f, 0x80); // no local color table, but transparency
+    
+    if( localPalette )
+    {
+        GifBufferPut(f, 0x80 + pPal->bitDepth-1); // local color table present, 2 ^ bitDepth entries
+        GifWritePalette(pPal, f);
+    }
+    else
+    {
+        GifBufferPut(f, 0); // no local color table, the global one applies
+    }
     
     const int minCodeSize = pPal->bitDepth;
     const uint32_t clearCode = 1 << pPal->bitDepth;
     
-    fputc(minCodeSize, f); // min code size 8 bits
-    
-    GifLzwNode* codetree = (GifLzwNode*)GIF_TEMP_MALLOC(sizeof(GifLzwNode)*4096);
+    GifBufferPut(f, minCodeSize); // min code size 8 bits
     
-    memset(codetree, 0, sizeof(GifLzwNode)*4096);
     int32_t curCode = -1;
     uint32_t codeSize = minCodeSize+1;
     uint32_t maxCode = clearCode+1;
@@ -690,7 +1171,8 @@ void GifWriteLzwImage(FILE* f, uint8_t* image, uint32_t left, uint32_t top,  uin
                     // the dictionary is full, clear it out and begin anew
                     GifWriteCode(f, stat, clearCode, codeSize); // clear tree
                     
-                    memset(codetree, 0, sizeof(GifLzwNode)*4096);
+                    // only nodes up to maxCode can have children
+                    memset(codetree, 0, sizeof(GifLzwNode)*(maxCode+1));
                     curCode = -1;
                     codeSize = minCodeSize+1;
                     maxCode = clearCode+1;
@@ -710,116 +1192,351 @@ void GifWriteLzwImage(FILE* f, uint8_t* image, uint32_t left, uint32_t top,  uin
     while( stat.bitIndex ) GifWriteBit(stat, 0);
     if( stat.chunkIndex ) GifWriteChunk(f, stat);
     
-    fputc(0, f); // image block terminator
+    GifBufferPut(f, 0); // image block terminator
     
-    GIF_TEMP_FREE(codetree);
+    // leave the tree clean for the next frame
+    memset(codetree, 0, sizeof(GifLzwNode)*(maxCode+1));
 }
 
+// Receives the bytes of a GIF as they are produced, in large blocks.
+// Returns false if they could not be written.
+typedef bool (*GifWriteFunc)( void* context, const uint8_t* data, uint32_t size );
+
+// GifWriteFunc for GIFs written to a FILE*
+bool GifWriteToFile( void* context, const uint8_t* data, uint32_t size )
+{
+    return fwrite(data, 1, size, (FILE*)context) == size;
+}
+
+// the writer collects output in its buffer and hands it to the sink once it holds this many bytes
+const uint32_t kGifFlushSize = 64*1024;
+
 struct GifWriter
 {
-    FILE* f;
+    GifWriteFunc write;  // sink the GIF goes to
+    void* context;       // passed to write
+    FILE* f;             // file opened by GifBegin, or NULL when writing to a sink given to GifBeginWithSink
+    bool ok;             // false once the sink has failed
+    GifBuffer buffer;    // output not yet handed to the sink
+    GifBuffer pending;   // last encoded frame written, held back until the next different frame fixes its delay
+    uint32_t pendingDelay;
+    bool hasPending;
+    uint32_t width;      // size of the canvas
+    uint32_t height;
+    uint8_t* heldImage;  // last frame given to GifWriteFrame, encoded once the frame after it is known
+    uint32_t heldDelay;
+    int heldBitDepth;
+    bool heldDither;
+    int heldAlphaThreshold;
+    bool hasHeldImage;
+    GifBuffer frame;     // frame being encoded by GifWriteFrame
     uint8_t* oldImage;
     bool firstFrame;
+    GifScratch scratch;  // reused by every frame written with GifWriteFrame
 };
 
-// Creates a gif file.
+// writes the held back encoded frame to the output, with its final delay
+void GifWritePending( GifWriter* writer )
+{
+    if( !writer->hasPending ) return;
+    
+    // the delay in the graphics control extension at the start of the frame
+    writer->pending.data[4] = writer->pendingDelay & 0xff;
+    writer->pending.data[5] = (writer->pendingDelay >> 8) & 0xff;
+    GifBufferWrite(&writer->buffer, writer->pending.data, writer->pending.size);
+    writer->hasPending = false;
+}
+
+// hands the buffered output to the sink, if there is enough of it (or any of it when force is set)
+void GifFlush( GifWriter* writer, bool force )
+{
+    if( writer->buffer.size == 0 || (!force && writer->buffer.size < kGifFlushSize) ) return;
+    
+    if( writer->ok )
+        writer->ok = writer->write(writer->context, writer->buffer.data, writer->buffer.size);
+    writer->buffer.size = 0;
+}
+
+// frees the memory of a writer and marks it as ended
+void GifFreeWriter( GifWriter* writer )
+{
+    GIF_FREE(writer->oldImage);
+    GIF_FREE(writer->heldImage);
+    GifScratchFree(&writer->scratch);
+    GifBufferFree(&writer->buffer);
+    GifBufferFree(&writer->pending);
+    GifBufferFree(&writer->frame);
+    
+    writer->write = NULL;
+    writer->f = NULL;
+    writer->oldImage = NULL;
+    writer->heldImage = NULL;
+}
+
+// Starts a gif that is handed to write (with context) in blocks instead of going to a file.
 // The input GIFWriter is assumed to be uninitialized.
 // The delay value is the time between frames in hundredths of a second - note that not all viewers pay much attention to this value.
-bool GifBegin( GifWriter* writer, const char* filename, uint32_t width, uint32_t height, uint32_t delay, int32_t bitDepth = 8, bool dither = false )
+// If globalPalette is given it is written as the global color table, for frames encoded with GifEncodeFrameGlobal.
+// Returns false (and ends the writer) if the header could not be handed to the sink.
+bool GifBeginWithSink( GifWriter* writer, GifWriteFunc write, void* context, uint32_t width, uint32_t height, uint32_t delay, int32_t bitDepth = 8, bool dither = false, const GifPalette* globalPalette = NULL )
 {
-#if _MSC_VER >= 1400
-	writer->f = 0;
-    fopen_s(&writer->f, filename, "wb");
-#else
-    writer->f = fopen(filename, "wb");
-#endif
-    if(!writer->f) return false;
+    (void)bitDepth; (void)dither;
     
+    writer->write = write;
+    writer->context = context;
+    writer->f = NULL;
+    writer->ok = true;
+    writer->hasPending = false;
+    writer->pendingDelay = 0;
+    writer->hasHeldImage = false;
+    writer->width = width;
+    writer->height = height;
     writer->firstFrame = true;
     
     // allocate 
     writer->oldImage = (uint8_t*)GIF_MALLOC(width*height*4);
+    writer->heldImage = (uint8_t*)GIF_MALLOC(width*height*4);
+    GifScratchInit(&writer->scratch);
+    GifScratchReserve(&writer->scratch, width, height);
+    GifBufferInit(&writer->buffer);
+    GifBufferInit(&writer->pending);
+    GifBufferInit(&writer->frame);
     
-    fputs("GIF89a", writer->f);
+    GifBuffer* out = &writer->buffer;
+    GifBufferWrite(out, "GIF89a", 6);
     
     // screen descriptor
-    fputc(width & 0xff, writer->f);
-    fputc((width >> 8) & 0xff, writer->f);
-    fputc(height & 0xff, writer->f);
-    fputc((height >> 8) & 0xff, writer->f);
-    
-    fputc(0xf0, writer->f);  // there is an unsorted global color table of 2 entries
-    fputc(0, writer->f);     // background color
-    fputc(0, writer->f);     // pixels are square (we need to specify this because it's 1989)
-    
-    // now the "global" palette (really just a dummy palette)
-    // color 0: black
-    fputc(0, writer->f);
-    fputc(0, writer->f); 
-    fputc(0, writer->f);
-    // color 1: also black
-    fputc(0, writer->f);
-    fputc(0, writer->f);
-    fputc(0, writer->f);
+    GifBufferPut(out, width & 0xff);
+    GifBufferPut(out, (width >> 8) & 0xff);
+    GifBufferPut(out, height & 0xff);
+    GifBufferPut(out, (height >> 8) & 0xff);
+    
+    if( globalPalette )
+    {
+        GifBufferPut(out, 0xf0 + globalPalette->bitDepth-1);  // unsorted global color table of 2 ^ bitDepth entries
+        GifBufferPut(out, 0);     // background color
+        GifBufferPut(out, 0);     // pixels are square
+        GifWritePalette(globalPalette, out);
+    }
+    else
+    {
+        GifBufferPut(out, 0xf0);  // there is an unsorted global color table of 2 entries
+        GifBufferPut(out, 0);     // background color
+        GifBufferPut(out, 0);     // pixels are square (we need to specify this because it's 1989)
+    
+        // now the "global" palette (really just a dummy palette)
+        // color 0: black
+        GifBufferPut(out, 0);
+        GifBufferPut(out, 0); 
+        GifBufferPut(out, 0);
+        // color 1: also black
+        GifBufferPut(out, 0);
+        GifBufferPut(out, 0);
+        GifBufferPut(out, 0);
+    }
     
     if( delay != 0 )
     {
         // animation header
-        fputc(0x21, writer->f); // extension
-        fputc(0xff, writer->f); // application specific
-        fputc(11, writer->f); // length 11
-        fputs("NETSCAPE2.0", writer->f); // yes, really
-        fputc(3, writer->f); // 3 bytes of NETSCAPE2.0 data
+        GifBufferPut(out, 0x21); // extension
+        GifBufferPut(out, 0xff); // application specific
+        GifBufferPut(out, 11); // length 11
+        GifBufferWrite(out, "NETSCAPE2.0", 11); // yes, really
+        GifBufferPut(out, 3); // 3 bytes of NETSCAPE2.0 data
         
-        fputc(1, writer->f); // JUST BECAUSE
-        fputc(0, writer->f); // loop infinitely (byte 0)
-        fputc(0, writer->f); // loop infinitely (byte 1)
+        GifBufferPut(out, 1); // JUST BECAUSE
+        GifBufferPut(out, 0); // loop infinitely (byte 0)
+        GifBufferPut(out, 0); // loop infinitely (byte 1)
         
-        fputc(0, writer->f); // block terminator
+        GifBufferPut(out, 0); // block terminator
     }
     
+    // hand the header to the sink right away, so a sink that cannot be written fails before any frame is encoded
+    GifFlush(writer, true);
+    if( !writer->ok )
+    {
+        GifFreeWriter(writer);
+        return false;
+    }
     return true;
 }
 
-// Writes out a new frame to a GIF in progress.
-// The GIFWriter should have been created by GIFBegin.
-// AFAIK, it is legal to use different bit depths for different frames of an image -
-// this may be handy to save bits in animations that don't change much.
-bool GifWriteFrame( GifWriter* writer, const uint8_t* image, uint32_t width, uint32_t height, uint32_t delay, int bitDepth = 8, bool dither = false )
+// Creates a gif file.
+// The input GIFWriter is assumed to be uninitialized.
+// The delay value is the time between frames in hundredths of a second - note that not all viewers pay much attention to this value.
+bool GifBegin( GifWriter* writer, const char* filename, uint32_t width, uint32_t height, uint32_t delay, int32_t bitDepth = 8, bool dither = false )
 {
-    if(!writer->f) return false;
+    FILE* f;
+#if _MSC_VER >= 1400
+	f = 0;
+    fopen_s(&f, filename, "wb");
+#else
+    f = fopen(filename, "wb");
+#endif
+    if(!f)
+    {
+        writer->write = NULL;
+        return false;
+    }
     
-    const uint8_t* oldImage = writer->firstFrame? NULL : writer->oldImage;
-    writer->firstFrame = false;
+    if( !GifBeginWithSink(writer, GifWriteToFile, f, width, height, delay, bitDepth, dither) )
+    {
+        fclose(f);
+        return false;
+    }
+    writer->f = f;
+    return true;
+}
+
+// Picks a palette for a frame and palettizes it into outFrame (palette index in the alpha channel).
+// The palette is exact if the pixels that changed since lastFrame have at most 255 colors;
+// otherwise it is a median split palette of at most 2 ^ bitDepth colors, optionally dithered.
+void GifPalettizeFrame( const uint8_t* lastFrame, const uint8_t* image, uint8_t* outFrame, uint32_t width, uint32_t height, int bitDepth, bool dither, GifPalette* pal, GifScratch* scratch )
+{
+    GifExactInit(&scratch->exact);
+    if( GifExactAddImage(&scratch->exact, (dither? NULL : lastFrame), image, width*height) && scratch->exact.count < (1 << bitDepth) )
+    {
+        GifExactMakePalette(&scratch->exact, pal);
+        GifExactMapImage(lastFrame, image, outFrame, width*height, &scratch->exact);
+        return;
+    }
     
-    GifPalette pal;
-    GifMakePalette((dither? NULL : oldImage), image, width, height, bitDepth, dither, &pal);
+    GifMakePalette((dither? NULL : lastFrame), image, width, height, bitDepth, dither, pal, scratch->image);
     
     if(dither)
-        GifDitherImage(oldImage, image, writer->oldImage, width, height, &pal);
+        GifDitherImage(lastFrame, image, outFrame, width, height, pal, &scratch->matcher, GifScratchQuantPixels(scratch, width, height));
     else
-        GifThresholdImage(oldImage, image, writer->oldImage, width, height, &pal);
+        GifThresholdImage(lastFrame, image, outFrame, width, height, pal, &scratch->matcher);
+}
+
+// Palettizes and LZW-compresses one frame into out, ready to be written with GifWriteEncodedFrame.
+// lastFrame is the previous frame (or NULL for the first one) and followingFrame the next one (or NULL
+// for the last one). Only the rectangle around the pixels that changed from lastFrame is encoded, and
+// inside it the pixels that did not change are left transparent, as are the pixels with an alpha below
+// alphaThreshold (see GifPrepareFrame). Returns false, leaving out empty, if no pixel changed.
+// The function only touches its arguments, so different frames can be encoded at the same time
+// on different threads as long as each thread has its own scratch.
+bool GifEncodeFrame( const uint8_t* lastFrame, const uint8_t* image, const uint8_t* followingFrame, uint32_t width, uint32_t height, GifBuffer* out, GifScratch* scratch, int alphaThreshold = 0, int bitDepth = 8, bool dither = false )
+{
+    const uint8_t* last;
+    const uint8_t* next;
+    if( !GifPrepareFrame(lastFrame, image, followingFrame, width, height, alphaThreshold, scratch, &last, &next) ) return false;
+    
+    GifPalette pal;
+    GifPalettizeFrame(last, next, scratch->quantized, scratch->width, scratch->height, bitDepth, dither, &pal, scratch);
     
-    GifWriteLzwImage(writer->f, writer->oldImage, 0, 0, width, height, delay, &pal);
+    GifWriteGraphicsControl(out, 0, scratch->disposal);
+    GifWriteLzwImage(out, scratch->quantized, scratch->left, scratch->top, scratch->width, scratch->height, &pal, scratch->codetree);
+    return true;
+}
+
+// Like GifEncodeFrame, for a GIF started with a global palette made by GifExactMakePalette from
+// table. table must hold every opaque color of the frame; the frame gets no color table of its own.
+bool GifEncodeFrameGlobal( const uint8_t* lastFrame, const uint8_t* image, const uint8_t* followingFrame, uint32_t width, uint32_t height, GifBuffer* out, GifScratch* scratch, int alphaThreshold, const GifExactTable* table, const GifPalette* globalPalette )
+{
+    const uint8_t* last;
+    const uint8_t* next;
+    if( !GifPrepareFrame(lastFrame, image, followingFrame, width, height, alphaThreshold, scratch, &last, &next) ) return false;
     
+    GifExactMapImage(last, next, scratch->quantized, scratch->width*scratch->height, table);
+    GifWriteGraphicsControl(out, 0, scratch->disposal);
+    GifWriteLzwImage(out, scratch->quantized, scratch->left, scratch->top, scratch->width, scratch->height, globalPalette, scratch->codetree, false);
     return true;
 }
 
-// Writes the EOF code, closes the file handle, and frees temp memory used by a GIF.
+// Writes a frame encoded by GifEncodeFrame, to be shown for delay hundredths of a second, to a GIF in progress.
+// Frames must be written in order. An empty frame (one that was the same as the frame before it) is not
+// written at all; its delay is added to the delay of the frame before it instead.
+bool GifWriteEncodedFrame( GifWriter* writer, const GifBuffer* frame, uint32_t delay )
+{
+    if(!writer->write) return false;
+    
+    writer->firstFrame = false;
+    if( frame->size == 0 )
+    {
+        if( writer->hasPending )
+            writer->pendingDelay = (uint32_t)GifIMin(writer->pendingDelay + delay, 0xffff);
+        return writer->ok;
+    }
+    
+    GifWritePending(writer);
+    GifFlush(writer, false);
+    
+    writer->pending.size = 0;
+    GifBufferWrite(&writer->pending, frame->data, frame->size);
+    writer->pendingDelay = delay;
+    writer->hasPending = true;
+    return writer->ok;
+}
+
+// encodes and writes the frame held back by GifWriteFrame, now that the frame after it is known
+void GifWriteHeldFrame( GifWriter* writer, const uint8_t* followingFrame )
+{
+    if( !writer->hasHeldImage ) return;
+    writer->hasHeldImage = false;
+    
+    const uint8_t* oldImage = writer->firstFrame? NULL : writer->oldImage;
+    GifScratch* sc = &writer->scratch;
+    writer->frame.size = 0;
+    if( GifEncodeFrame(oldImage, writer->heldImage, followingFrame, writer->width, writer->height, &writer->frame, sc,
+                       writer->heldAlphaThreshold, writer->heldBitDepth, writer->heldDither) )
+    {
+        // the next frame is compared with this one as it was palettized
+        for( uint32_t yy=0; yy<sc->height; ++yy )
+        {
+            uint8_t* dest = writer->oldImage + ((sc->top+yy)*writer->width + sc->left)*4;
+            const uint8_t* quantized = sc->quantized + yy*sc->width*4;
+            const uint8_t* normalized = sc->croppedNext + yy*sc->width*4;
+            for( uint32_t xx=0; xx<sc->width*4; xx += 4 )
+            {
+                dest[xx] = quantized[xx];
+                dest[xx+1] = quantized[xx+1];
+                dest[xx+2] = quantized[xx+2];
+                dest[xx+3] = normalized[xx+3];
+            }
+        }
+    }
+    
+    GifWriteEncodedFrame(writer, &writer->frame, writer->heldDelay);
+}
+
+// Writes out a new frame to a GIF in progress. Pixels with an alpha below alphaThreshold are transparent.
+// The GIFWriter should have been created by GIFBegin. The frame is written once the frame after it
+// (or GifEnd) tells whether it has to be cleared for transparent pixels of that frame.
+// AFAIK, it is legal to use different bit depths for different frames of an image -
+// this may be handy to save bits in animations that don't change much.
+bool GifWriteFrame( GifWriter* writer, const uint8_t* image, uint32_t width, uint32_t height, uint32_t delay, int bitDepth = 8, bool dither = false, int alphaThreshold = 0 )
+{
+    if(!writer->write) return false;
+    
+    GifWriteHeldFrame(writer, image);
+    
+    memcpy(writer->heldImage, image, width*height*4);
+    writer->heldDelay = delay;
+    writer->heldBitDepth = bitDepth;
+    writer->heldDither = dither;
+    writer->heldAlphaThreshold = alphaThreshold;
+    writer->hasHeldImage = true;
+    return writer->ok;
+}
+
+// Writes the EOF code, hands the rest of the output to the sink (closing the file if GifBegin opened one),
+// and frees temp memory used by a GIF. Returns false if any of the output could not be written.
 // Many if not most viewers will still display a GIF properly if the EOF code is missing,
 // but it's still a good idea to write it out.
 bool GifEnd( GifWriter* writer )
 {
-    if(!writer->f) return false;
+    if(!writer->write) return false;
     
-    fputc(0x3b, writer->f); // end of file
-    fclose(writer->f);
-    GIF_FREE(writer->oldImage);
+    GifWriteHeldFrame(writer, NULL);
+    GifWritePending(writer);
+    GifBufferPut(&writer->buffer, 0x3b); // end of file
+    GifFlush(writer, true);
+    if(writer->f && fclose(writer->f) != 0)
+        writer->ok = false;
+    GifFreeWriter(writer);
     
-    writer->f = NULL;
-    writer->oldImage = NULL;
-    
-    return true;
+    return writer->ok;
 }
 
 #endif
@@ -0,0 +1,252 @@
+/*
+ * gifexporter.cpp
+ * An implementation of the GifExporter class.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#include "gifexporter.h"
+#include "gif.h"
+#include <QFile>
+#include <QBuffer>
+#include <QFuture>
+#include <QList>
+#include <QtConcurrent>
+#include <QThreadStorage>
+#include <string.h>
+
+/*
+ * the memory one encoding thread reuses for every frame it encodes: the LZW code tree (about 2 MB), the working copies
+ * of the frame, the copies of the frame and its neighbours taken from the project, and the encoded output. the buffers
+ * only grow, and the pool threads outlive an export, so later exports reuse them too.
+*/
+struct EncoderScratch{
+    GifScratch scratch;
+    GifBuffer output;
+    vector<uint8_t> image; //the frame being encoded
+    vector<uint8_t> previous; //the frame before it
+    vector<uint8_t> following; //the frame after it
+    EncoderScratch(){
+        GifScratchInit(&scratch);
+        GifBufferInit(&output);
+    }
+    ~EncoderScratch(){
+        GifScratchFree(&scratch);
+        GifBufferFree(&output);
+    }
+};
+
+static QThreadStorage<EncoderScratch*> encoderScratch; //one for each thread that has encoded a frame
+
+/*
+ * creates an exporter for a snapshot of the frames. copying the frames only shares their pixels.
+*/
+GifExporter::GifExporter(const vector<Frame>& frames, int frameSize, int playbackSpeed, QObject* parent) :
+    QObject(parent),
+    frames_(frames),
+    frameSize_(frameSize),
+    playbackSpeed_(playbackSpeed),
+    alphaThreshold_(128),
+    useGlobalPalette_(true),
+    canceled_(0){
+
+}
+
+/*
+ * frees the global palette (the gif.h types are only complete in this file)
+*/
+GifExporter::~GifExporter(){
+
+}
+
+/*
+ * collects the colors of every frame into one exact palette. if the whole animation uses at most 255 colors it is
+ * written as the global color table and every frame maps its pixels straight into it, so no frame needs a palette of
+ * its own and nothing is lost to quantization. returns false (and clears the table) if there are too many colors.
+ * transparent pixels need no color.
+*/
+bool GifExporter::makeGlobalPalette(){
+    globalTable_.reset(new GifExactTable);
+    GifExactInit(globalTable_.get());
+    for(unsigned int i = 0; i < frames_.size(); i++){
+        const PixelBuffer& pixels = frames_[i].pixels();
+        for(int row = 0; row < frameSize_; row++){
+            const uint8_t* pixel = pixels.constScanLine(row);
+            for(int col = 0; col < frameSize_; col++, pixel += PixelBuffer::BYTES_PER_PIXEL){
+                if(pixel[3] >= alphaThreshold_ && !GifExactAdd(globalTable_.get(), pixel[0], pixel[1], pixel[2])){
+                    globalTable_.reset();
+                    return false;
+                }
+            }
+        }
+    }
+    globalPalette_.reset(new GifPalette);
+    GifExactMakePalette(globalTable_.get(), globalPalette_.get());
+    return true;
+}
+
+/*
+ * asks the export to stop. frames that are not encoded yet are skipped and the partly written file is removed.
+*/
+void GifExporter::cancel(){
+    canceled_.storeRelease(1);
+}
+
+/*
+ * copies the rows and columns of frame index that are exported into image, one row after the other
+*/
+void GifExporter::copyVisiblePixels(int index, uint8_t* image) const{
+    const PixelBuffer& pixels = frames_[index].pixels();
+    int rowSize = frameSize_*PixelBuffer::BYTES_PER_PIXEL;
+    for(int row = 0; row < frameSize_; row++){
+        memcpy(image + row*rowSize, pixels.constScanLine(row), rowSize);
+    }
+}
+
+/*
+ * returns the time frame index is shown for in hundredths of a second (the unit of gif delays), rounded to the nearest
+ * one. frames without a duration of their own use the playback speed.
+*/
+int GifExporter::frameDelay(int index) const{
+    int duration = frames_[index].duration() > 0 ? frames_[index].duration() : playbackSpeed_;
+    return qBound(1, (duration+5)/10, 0xffff);
+}
+
+/*
+ * returns the GIF data (disposal, palette and compressed image) of frame index. only the rectangle around the pixels
+ * that changed since the previous frame is encoded, and the unchanged pixels inside it are left transparent, so each
+ * frame only depends on the frames next to it and not on the result of encoding them. that is what lets all the frames
+ * be encoded at the same time. a frame that is the same as the one before it comes back empty. the next frame is
+ * needed too: if some of its pixels turn transparent, this frame has to be cleared away before it is drawn.
+*/
+QByteArray GifExporter::encodeFrame(int index) const{
+    if(canceled_.loadAcquire()){
+        return QByteArray();
+    }
+    if(!encoderScratch.hasLocalData()){
+        encoderScratch.setLocalData(new EncoderScratch());
+    }
+    EncoderScratch* scratch = encoderScratch.localData();
+
+    //resize keeps the capacity of a vector that is big enough, so after the first frame this allocates nothing
+    size_t imageSize = frameSize_*frameSize_*PixelBuffer::BYTES_PER_PIXEL;
+    scratch->image.resize(imageSize);
+    copyVisiblePixels(index, scratch->image.data());
+    const uint8_t* lastFrame = NULL;
+    const uint8_t* followingFrame = NULL;
+    if(index > 0){
+        scratch->previous.resize(imageSize);
+        copyVisiblePixels(index-1, scratch->previous.data());
+        lastFrame = scratch->previous.data();
+    }
+    if(index+1 < int(frames_.size())){
+        scratch->following.resize(imageSize);
+        copyVisiblePixels(index+1, scratch->following.data());
+        followingFrame = scratch->following.data();
+    }
+
+    scratch->output.size = 0;
+    if(globalTable_){
+        GifEncodeFrameGlobal(lastFrame, scratch->image.data(), followingFrame, frameSize_, frameSize_, &scratch->output,
+                             &scratch->scratch, alphaThreshold_, globalTable_.get(), globalPalette_.get());
+    }
+    else{
+        GifEncodeFrame(lastFrame, scratch->image.data(), followingFrame, frameSize_, frameSize_, &scratch->output,
+                       &scratch->scratch, alphaThreshold_);
+    }
+    return QByteArray(reinterpret_cast<const char*>(scratch->output.data), scratch->output.size);
+}
+
+/*
+ * sink for gif.h that writes the GIF to a QIODevice
+*/
+static bool writeToDevice(void* context, const uint8_t* data, uint32_t size){
+    return static_cast<QIODevice*>(context)->write(reinterpret_cast<const char*>(data), size) == qint64(size);
+}
+
+/*
+ * writes the GIF to an open device. the frames are encoded in parallel, and each one is written as soon as it and all
+ * the frames before it are done. gif.h collects the output and writes it to the device in large blocks.
+ * this blocks until the export is finished, so run it off the gui thread.
+*/
+bool GifExporter::exportToDevice(QIODevice* device){
+    error_.clear();
+    GifWriter writer;
+    globalTable_.reset();
+    globalPalette_.reset();
+    if(useGlobalPalette_){
+        makeGlobalPalette();
+    }
+    if(!GifBeginWithSink(&writer, writeToDevice, device, frameSize_, frameSize_, frameDelay(0), 8, false, globalPalette_.get())){
+        error_ = device->errorString();
+        return false;
+    }
+
+    QList<int> indices;
+    for(unsigned int i = 0; i < frames_.size(); i++){
+        indices.append(i);
+    }
+    QFuture<QByteArray> encodedFrames = QtConcurrent::mapped(indices, EncodeFrame(this));
+
+    for(int i = 0; i < indices.size() && !canceled_.loadAcquire(); i++){
+        QByteArray frame = encodedFrames.resultAt(i); //waits for this frame only, the later ones keep encoding
+        GifBuffer buffer;
+        buffer.data = reinterpret_cast<uint8_t*>(frame.data());
+        buffer.size = frame.size();
+        buffer.capacity = frame.size();
+        GifWriteEncodedFrame(&writer, &buffer, frameDelay(i)); //an empty frame only makes the frame before it last longer
+        emit progressChanged(i+1, indices.size());
+    }
+    bool written = GifEnd(&writer);
+
+    if(canceled_.loadAcquire()){
+        encodedFrames.cancel();
+        encodedFrames.waitForFinished();
+        return false;
+    }
+    if(!written){
+        error_ = device->errorString();
+        return false;
+    }
+    return true;
+}
+
+/*
+ * writes the GIF to fileName. a file left over from a failed or canceled export is removed.
+*/
+bool GifExporter::exportToFile(const QString& fileName){
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly)){
+        error_ = tr("Could not create %1: %2").arg(fileName).arg(file.errorString());
+        return false;
+    }
+    bool exported = exportToDevice(&file);
+    file.close();
+    if(!exported){
+        file.remove();
+        if(!error_.isEmpty()){
+            error_ = tr("Could not write all of %1: %2").arg(fileName).arg(error_);
+        }
+    }
+    return exported;
+}
+
+/*
+ * writes the GIF into memory, where data() returns it (for the clipboard, or to embed it somewhere without a file)
+*/
+bool GifExporter::exportToBuffer(){
+    data_.clear();
+    QBuffer buffer(&data_);
+    buffer.open(QIODevice::WriteOnly);
+    if(!exportToDevice(&buffer)){
+        data_.clear();
+        return false;
+    }
+    return true;
+}
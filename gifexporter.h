@@ -0,0 +1,88 @@
+/*
+ * gifexporter.h
+ * The GifExporter class writes the frames of a sprite as an animated GIF with gif.h. Each frame is palettized and
+ * LZW-compressed on its own (into its own buffer) on a pool of threads, and the encoded frames are written to the
+ * file in order as soon as they are ready, so long animations use every core instead of just the gui thread.
+ * Only the part of each frame that changed since the frame before it is stored, and a frame that did not change at all
+ * just makes the one before it last longer. Each frame is shown for its own duration (or for the playback speed), and
+ * pixels that are mostly transparent are transparent in the GIF.
+ * The GIF can go to a file, to memory or to any QIODevice. The export can itself be run in the background; it reports
+ * its progress and can be canceled from another thread.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#ifndef GIFEXPORTER_H
+#define GIFEXPORTER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include "frame.h"
+
+using namespace std;
+
+//defined in gif.h, which can only be included by gifexporter.cpp
+struct GifExactTable;
+struct GifPalette;
+
+class GifExporter : public QObject{
+    Q_OBJECT
+
+public:
+    GifExporter(const vector<Frame>& frames, int frameSize, int playbackSpeed, QObject* parent = nullptr); //exports the top left frameSize x frameSize pixels of each frame, showing frames without a duration for playbackSpeed milliseconds
+    ~GifExporter();
+
+    void setGlobalPalette(bool enabled) {useGlobalPalette_ = enabled;} //share one exact color table between all frames when they fit in it (on by default)
+    void setAlphaThreshold(int threshold) {alphaThreshold_ = threshold;} //pixels with a lower alpha are transparent (128 by default, 0 makes every pixel opaque)
+
+    bool exportToDevice(QIODevice* device); //writes the GIF to an open device. returns false if it failed or was canceled
+    bool exportToFile(const QString& fileName); //writes the GIF to a file. returns false if it failed or was canceled
+    bool exportToBuffer(); //writes the GIF into data(). returns false if it failed or was canceled
+    QByteArray data() const {return data_;} //the GIF made by exportToBuffer
+    QString errorString() const {return error_;} //why the last export failed (empty if it was canceled)
+    void cancel(); //asks the export in progress to stop. safe to call from any thread
+
+signals:
+    void progressChanged(int completed, int total); //emitted from the exporting thread as frames are written
+
+private:
+    /*
+     * encodes one frame for QtConcurrent::mapped
+    */
+    struct EncodeFrame{
+        typedef QByteArray result_type;
+        const GifExporter* exporter;
+        EncodeFrame(const GifExporter* exporter) : exporter(exporter){}
+        QByteArray operator()(int index) const {return exporter->encodeFrame(index);}
+    };
+
+    QByteArray encodeFrame(int index) const; //palettizes and compresses one frame (safe to call from several threads at once)
+    void copyVisiblePixels(int index, uint8_t* image) const; //copies the exported rows and columns of a frame into image
+    int frameDelay(int index) const; //time frame index is shown for, in hundredths of a second
+    bool makeGlobalPalette(); //collects the colors of all the frames into globalTable_ and globalPalette_, if there are at most 255
+
+    vector<Frame> frames_; //frames to export (shared with the caller's frames, so the export sees them as they were)
+    int frameSize_; //number of rows (columns) of each frame that are exported
+    int playbackSpeed_; //milliseconds a frame without a duration of its own is shown for
+    int alphaThreshold_; //pixels with an alpha below this are transparent
+    bool useGlobalPalette_; //true to try a global color table
+    unique_ptr<GifExactTable> globalTable_; //colors of the whole animation, or null if the frames have their own palettes
+    unique_ptr<GifPalette> globalPalette_; //global color table made from globalTable_
+    QAtomicInt canceled_; //set to 1 by cancel
+    QString error_; //description of the last failure
+    QByteArray data_; //output of exportToBuffer
+};
+
+#endif // GIFEXPORTER_H
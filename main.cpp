@@ -13,14 +13,27 @@
 
 #include "view.h"
 #include <QApplication>
+#include <QThread>
 #include "model.h"
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    QCoreApplication::setOrganizationName("A7"); //where QSettings keeps the editor's preferences
+    QCoreApplication::setApplicationName("Sprite Editor");
     Model m;
+
+    //projects are loaded and saved on their own thread so the editor and the preview keep running
+    QThread fileThread;
+    m.moveToThread(&fileThread);
+    fileThread.start();
+
     View w(m);
     w.show();
 
-    return a.exec();
+    int result = a.exec();
+    m.cancel();
+    fileThread.quit();
+    fileThread.wait();
+    return result;
 }
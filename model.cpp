@@ -12,127 +12,281 @@
 */
 
 #include "model.h"
-#include <QFileDialog>
-#include <QMessageBox>
-#include <QDir>
 #include <QDebug>
-#include <QPixmap>
 #include <QString>
+#include <QtEndian>
+#include <QSaveFile>
+#include <string.h>
 #include "frame.h"
+#include "ssptextreader.h"
 
-Model::Model(QObject *parent) : QObject(parent){
+Model::Model(QObject *parent) : QObject(parent), canceled_(0){
+    //frames are handed between the view and the model's thread through queued signals
+    qRegisterMetaType<vector<Frame>>("vector<Frame>");
+}
 
+/*
+ * asks the load or save in progress to stop as soon as possible. this is called directly from the gui thread while the
+ * model's thread is busy, so it only sets a flag that the loops check.
+*/
+void Model::cancel(){
+    canceled_.storeRelease(1);
 }
 
 /*
- * saves the frames_ to the file given by the fileName parameter according to the specifications in the assignment
+ * forgets a cancel left over from the last load or save. the view calls this on the gui thread before it queues the
+ * next one, so a cancel clicked while that load or save waits to start is not lost.
 */
-void Model::saveProject(vector<Frame*> frames_, int currentFrameSize_, QString fileName){
-    vector<Frame*>::iterator frame;
-    vector< vector<QColor> >::iterator row;
-    vector<QColor>::iterator col;
-
-    if(fileName.isEmpty())
-        return;
-    else{
-        QFile file(fileName);
-        if(!file.open(QIODevice::WriteOnly)){
-            emit fileFailedToOpen(file.errorString());
-          return;
+void Model::resetCancel(){
+    canceled_.storeRelease(0);
+}
+
+/*
+ * returns true if cancel was called since the current load or save was queued
+*/
+bool Model::isCanceled() const{
+    return canceled_.loadAcquire() != 0;
+}
+
+/*
+ * tells the view that completed of total frames are done. only emitted when the percentage changes so that huge
+ * projects do not flood the gui thread with events.
+*/
+void Model::reportProgress(int completed, int total){
+    if(total <= 100 || completed == total || completed*100/total != (completed-1)*100/total){
+        emit progressChanged(completed, total);
+    }
+}
+
+/*
+ * saves the frames_ to the file given by the fileName parameter in the binary .ssp format (version 2): a header
+ * followed by one record per frame holding the raw RGBA8 bytes of the rows and columns that are in use.
+ * runs on the model's thread. the file is only replaced once all of it has been written, so canceling (or a failed
+ * write) leaves the old file as it was.
+*/
+void Model::saveProject(vector<Frame> frames_, int currentFrameSize_, QString fileName){
+    if(!fileName.isEmpty()){
+        QString error;
+        if(!writeProject(frames_, currentFrameSize_, fileName, error) && !error.isEmpty()){
+            emit fileFailedToOpen(error);
         }
+    }
+    emit operationFinished();
+}
 
-        QTextStream out( &file );
+/*
+ * writes the project for saveProject (or for the command line tool). returns false and sets error if the file could not
+ * be written, or returns false with an empty error if the save was canceled.
+*/
+bool Model::writeProject(const vector<Frame>& frames_, int currentFrameSize_, const QString& fileName, QString& error){
+    int rowSize = currentFrameSize_*PixelBuffer::BYTES_PER_PIXEL;
+    int frameBytes = FRAME_RECORD_SIZE+rowSize*currentFrameSize_;
+    QByteArray data;
+    data.reserve(HEADER_SIZE+frameBytes*int(frames_.size()));
 
-        out <<  currentFrameSize_ << ' ' <<  currentFrameSize_<<endl;
-        out << frames_.size()<< endl;
+    //header
+    data.append(SSP2_MAGIC, 4);
+    appendWord(data, SSP2_VERSION);
+    appendWord(data, currentFrameSize_); //width
+    appendWord(data, currentFrameSize_); //height
+    appendWord(data, frames_.size());
+    appendWord(data, HEADER_SIZE); //offset of the first frame record
+    appendWord(data, FRAME_RECORD_SIZE);
+    appendWord(data, 0); //reserved
 
-        for(frame=frames_.begin(); frame != frames_.end(); (frame)++){
-            vector< vector<QColor> > temp= (*frame)->getPixels();
-            for (int row = 0; row < currentFrameSize_; row++) {
-                for (int col = 0; col < currentFrameSize_; col++) {
-                    QColor item= temp[row][col];
-                    out<<item.red() <<' '<<item.green() <<' '<<item.blue() <<' '<<item.alpha() << ' ';
-                }
-            out<<'\n';
-            }
+    //frames, rows copied straight out of the pixel buffers
+    int total = frames_.size();
+    for(int f = 0; f < total; f++){
+        if(isCanceled()){
+            return false;
+        }
+        appendWord(data, frames_[f].duration()); //duration in milliseconds (0 means the project's playback speed)
+        appendWord(data, 0); //reserved
+        const PixelBuffer& pixels = frames_[f].pixels();
+        for(int row = 0; row < currentFrameSize_; row++){
+            data.append(reinterpret_cast<const char*>(pixels.constScanLine(row)), rowSize);
         }
+        reportProgress(f+1, total);
+    }
+
+    QSaveFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly)){
+        error = file.errorString();
+        return false;
+    }
+    if(file.write(data) != data.size() || isCanceled()){
+        error = isCanceled() ? QString() : file.errorString();
+        file.cancelWriting();
+        return false;
+    }
+    if(!file.commit()){
+        error = file.errorString();
+        return false;
     }
+    return true;
 }
 
 /*
- * loads a project saved to the given fileName for the view
+ * loads a project saved to the given fileName for the view. binary (version 2) files are memory mapped and their pixels
+ * copied straight into the frames; older text files are parsed. runs on the model's thread; the frames are only handed
+ * to the view (through finishLoadingProject) once the whole project has been read.
 */
 void Model::loadProject(QString fileName){
-    vector<Frame*> newFrames;
-    if(fileName.isEmpty())
-            return;
-    else{
+    if(!fileName.isEmpty()){
+        vector<Frame> newFrames;
+        int frameSize = 0;
+        QString error;
+        if(readProject(fileName, newFrames, frameSize, error)){
+            emit finishLoadingProject(newFrames, frameSize);
+        }
+        else if(!error.isEmpty()){
+            emit fileFailedToOpen(error);
+        }
+    }
+    emit operationFinished();
+}
 
-        QFile file(fileName);
+/*
+ * reads the project for loadProject (or for the command line tool). returns false and sets error if the file could not
+ * be read, or returns false with an empty error if the load was canceled.
+*/
+bool Model::readProject(const QString& fileName, vector<Frame>& frames, int& frameSize, QString& error){
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly)){
+        error = file.errorString();
+        return false;
+    }
 
-        if(!file.open(QIODevice::ReadOnly)){
-            emit fileFailedToOpen(file.errorString());
-            return;
-        }
+    if(file.peek(4) == QByteArray(SSP2_MAGIC, 4)){
+        return loadBinaryProject(file, frames, frameSize, error);
+    }
+    return loadTextProject(file, frames, frameSize, error);
+}
 
-        QTextStream in(&file);
-        QString line = in.readLine();
-        QStringList dimension= line.split(" ");
-        QString row= dimension.first();
-        QString col= dimension.last();
-
-        unsigned int rowSize=row.toInt();
-        unsigned int colSize=col.toInt();
-        vector<vector<QColor>> newPixels(MAX_FRAME_SIZE, vector<QColor>(MAX_FRAME_SIZE));
-        line=in.readLine();
-        unsigned int frameNum= line.toInt();
-
-        for(unsigned int f=0; f<frameNum;f++){ //for each frame
-            for(unsigned int i=0; i<rowSize;i++){ //for number of rows in a frame
-                line=in.readLine();//next row
-
-                vector<int> rgba;
-                QStringList  row = line.split(" ");
-                for(unsigned int j=0; j<colSize;j++){//for whole line (columns)
-                    for(unsigned int k=0; k<4;k++){ //for every 4 values
-                        QString num=row.first(); //get first number
-                        rgba.push_back(num.toInt());
-                        row.removeFirst();
-                    }
-                    QColor newColor; //create new qcolor from rgba
-                    int a= rgba.back();
-                    rgba.pop_back();
-                    int b = rgba.back();
-                    rgba.pop_back();
-                    int g= rgba.back();
-                    rgba.pop_back();
-                    int r= rgba.back();
-                    rgba.pop_back();
-                    newColor.setRgb( r,  g,  b,  a);
-                    newPixels[i][j]=newColor; //add to this row and col number
-                }
+/*
+ * reads a binary (version 2) project from an open file. the file is memory mapped when possible so the frame records
+ * are copied from the page cache into the frames without an extra read buffer. returns false and sets error if the
+ * file is not a valid project, or returns false with an empty error if the load was canceled.
+*/
+bool Model::loadBinaryProject(QFile& file, vector<Frame>& frames, int& frameSize, QString& error){
+    qint64 fileSize = file.size();
+    QByteArray readData;
+    const uchar* data = file.map(0, fileSize);
+    if(data == nullptr){ //some files (e.g. on special file systems) cannot be mapped
+        readData = file.readAll();
+        data = reinterpret_cast<const uchar*>(readData.constData());
+        fileSize = readData.size();
+    }
 
-            }
+    if(fileSize < HEADER_SIZE){
+        error = tr("The file is too short to be a sprite project.");
+        return false;
+    }
+    quint32 version = readWord(data+4);
+    quint32 width = readWord(data+8);
+    quint32 height = readWord(data+12);
+    quint32 frameCount = readWord(data+16);
+    quint32 dataOffset = readWord(data+20);
+    quint32 recordSize = readWord(data+24);
+    if(version != SSP2_VERSION){
+        error = tr("The file uses an unsupported version of the sprite format (%1).").arg(version);
+        return false;
+    }
+    if(width == 0 || width > quint32(MAX_FRAME_SIZE) || width != height){
+        error = tr("The file has an unsupported frame size (%1 x %2).").arg(width).arg(height);
+        return false;
+    }
+    if(recordSize < quint32(FRAME_RECORD_SIZE) || recordSize > quint32(MAX_FRAME_RECORD_SIZE)){
+        error = tr("The file is not a valid sprite project.");
+        return false;
+    }
+    qint64 rowSize = qint64(width)*PixelBuffer::BYTES_PER_PIXEL;
+    qint64 frameBytes = recordSize+rowSize*height;
+    if(frameCount == 0){
+        error = tr("The project has no frames.");
+        return false;
+    }
+    if(dataOffset < quint32(HEADER_SIZE) || qint64(dataOffset)+frameBytes*frameCount > fileSize){
+        error = tr("The file is truncated: it should hold %1 frames.").arg(frameCount);
+        return false;
+    }
 
-            for(unsigned int c = colSize; c<MAX_FRAME_SIZE;c++){
-                for(unsigned int r =0; r<colSize; r++){
+    frames.reserve(frameCount);
+    const uchar* record = data+dataOffset;
+    for(quint32 f = 0; f < frameCount; f++){
+        //cells outside the frame size are white, like in a new frame
+        PixelBuffer pixels(MAX_FRAME_SIZE, MAX_FRAME_SIZE, QColor(255,255,255), &FramePool::instance());
+        const uchar* rows = record+recordSize;
+        for(quint32 row = 0; row < height; row++){
+            memcpy(pixels.scanLine(row), rows+row*rowSize, rowSize);
+        }
+        frames.push_back(Frame(move(pixels)));
+        frames.back().setDuration(qMin(readWord(record), quint32(MAX_FRAME_DURATION)));
+        record += frameBytes;
+        reportProgress(f+1, frameCount);
+        if(isCanceled()){
+            return false;
+        }
+    }
+    frameSize = width;
+    return true;
+}
 
-                    QColor newColor;
-                    newColor.setRgb( 255,255,255,255);
-                    newPixels[r][c] = newColor;
-                }
-            }
-            for(unsigned int r = rowSize; r<MAX_FRAME_SIZE;r++){
-                for(unsigned int c = 0; c<MAX_FRAME_SIZE;c++)
-                {
-                QColor newColor;
-                newColor.setRgb( 255,255,255,255);
-                newPixels[r][c] = newColor;
-                }
+/*
+ * reads a project saved as text (the original .ssp format: the frame size, the number of frames, then one line per row
+ * with four numbers per pixel) from an open file. the numbers are parsed straight into the pixel buffers of the frames.
+ * returns false and sets error (with the line of the problem) if the file is not a valid project, or returns false with
+ * an empty error if the load was canceled.
+*/
+bool Model::loadTextProject(QFile& file, vector<Frame>& frames, int& frameSize, QString& error){
+    SspTextReader in(&file);
+
+    int rowSize, colSize, frameNum;
+    if(!in.readInt(rowSize) || !in.readInt(colSize) || !in.readInt(frameNum)){
+        error = tr("Line %1 of the file: %2.").arg(in.lineNumber()).arg(in.errorString());
+        return false;
+    }
+    if(rowSize <= 0 || rowSize > MAX_FRAME_SIZE || colSize <= 0 || colSize > MAX_FRAME_SIZE){
+        error = tr("The file has an unsupported frame size (%1 x %2).").arg(rowSize).arg(colSize);
+        return false;
+    }
+    if(frameNum <= 0){
+        error = tr("The project has no frames.");
+        return false;
+    }
+
+    frames.reserve(frameNum);
+    for(int f=0; f<frameNum;f++){ //for each frame
+        //cells outside the frame size are white, like in a new frame
+        PixelBuffer newPixels(MAX_FRAME_SIZE, MAX_FRAME_SIZE, QColor(255,255,255), &FramePool::instance());
+        for(int i=0; i<rowSize;i++){ //for number of rows in a frame
+            if(!in.readChannels(newPixels.scanLine(i), colSize*PixelBuffer::BYTES_PER_PIXEL)){
+                error = tr("Line %1 of the file (frame %2): %3.").arg(in.lineNumber()).arg(f+1).arg(in.errorString());
+                return false;
             }
-            Frame* newFrame= new Frame(newPixels);
-            newFrames.push_back(newFrame);
         }
-        emit finishLoadingProject(newFrames);
+        frames.push_back(Frame(move(newPixels))); //hand the buffer to the frame without copying it
+        reportProgress(f+1, frameNum);
+        if(isCanceled()){
+            return false;
+        }
     }
+    frameSize = rowSize;
+    return true;
+}
+
+/*
+ * appends a 32 bit value to data in little endian byte order
+*/
+void Model::appendWord(QByteArray& data, quint32 value){
+    uchar bytes[4];
+    qToLittleEndian(value, bytes);
+    data.append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+/*
+ * reads a little endian 32 bit value
+*/
+quint32 Model::readWord(const uchar* bytes){
+    return qFromLittleEndian<quint32>(bytes);
 }
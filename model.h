@@ -15,25 +15,64 @@
 #define MODEL_H
 
 #include <QObject>
+#include <QFile>
+#include <QByteArray>
+#include <QAtomicInt>
+#include <QMetaType>
 #include <vector>
 #include "frame.h"
 
+/*
+ * the model is meant to live on its own thread (see main.cpp) so that loading and saving never block the editor.
+ * the view talks to it only through signals and slots, except for cancel and resetCancel, which are called directly.
+*/
 class Model : public QObject{
     Q_OBJECT
 
 public:
     explicit Model(QObject *parent = nullptr);
 
+    void cancel(); //asks the load or save in progress to stop. safe to call from any thread
+    void resetCancel(); //clears the cancel flag before the next load or save is queued
+
+    //the work behind the slots, done on the calling thread and reported through the return value instead of signals.
+    //the command line tool uses these directly, with one model for each thread.
+    bool writeProject(const vector<Frame>& frames, int frameSize, const QString& fileName, QString& error); //saves a project
+    bool readProject(const QString& fileName, vector<Frame>& frames, int& frameSize, QString& error); //loads a project
+
 signals:
     void fileFailedToOpen(QString error); //emitted when a file cannot be opened
-    void finishLoadingProject(vector<Frame*>);
+    void finishLoadingProject(vector<Frame> frames, int frameSize); //emitted with the frames of a project that finished loading
+    void progressChanged(int completed, int total); //emitted as frames are loaded or saved
+    void operationFinished(); //emitted when a load or save ends, whether it worked, failed or was canceled
 
 public slots:
     void loadProject(QString fileName);
-    void saveProject(vector<Frame*> frames, int currentFrameSize, QString fileName); //called when the project needs to be saved
+    void saveProject(vector<Frame> frames, int currentFrameSize, QString fileName); //called when the project needs to be saved
 
 private:
     const int MAX_FRAME_SIZE = 40; //maximum size of a frame in pixels (number of rows, number of columns leq MAX_FRAME_SIZE)
+
+    //binary project format (version 2). all numbers are 32 bit little endian.
+    //header: magic, version, width, height, frame count, offset of the first frame record, size of a frame record header, reserved
+    //frame record: duration in milliseconds, reserved, then width*height RGBA8 pixels row after row
+    static constexpr const char* SSP2_MAGIC = "SSP2";
+    static const quint32 SSP2_VERSION = 2;
+    static const int HEADER_SIZE = 32;
+    static const int FRAME_RECORD_SIZE = 8;
+    static const int MAX_FRAME_RECORD_SIZE = 4096; //newer versions may grow the record header, but not beyond this
+    static const quint32 MAX_FRAME_DURATION = 655350; //longest a frame can be shown, in milliseconds (the longest delay a gif can hold)
+
+    QAtomicInt canceled_; //set to 1 by cancel, cleared by resetCancel before a load or save is queued
+
+    bool isCanceled() const; //true if the load or save in progress should stop
+    void reportProgress(int completed, int total); //emits progressChanged when the percentage changes
+    bool loadBinaryProject(QFile& file, vector<Frame>& frames, int& frameSize, QString& error); //reads a version 2 project
+    bool loadTextProject(QFile& file, vector<Frame>& frames, int& frameSize, QString& error); //reads a project saved as text
+    static void appendWord(QByteArray& data, quint32 value); //writes a number of the binary format
+    static quint32 readWord(const uchar* bytes); //reads a number of the binary format
 };
 
+Q_DECLARE_METATYPE(vector<Frame>)
+
 #endif // MODEL_H
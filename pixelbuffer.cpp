@@ -0,0 +1,109 @@
+/*
+ * pixelbuffer.cpp
+ * An implementation of the PixelBuffer class.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#include "pixelbuffer.h"
+#include <string.h>
+
+/*
+ * creates an empty buffer with no pixels
+*/
+PixelBuffer::PixelBuffer() : width_(0), height_(0){
+
+}
+
+/*
+ * creates a buffer of the given size with every pixel set to fillColor. its memory comes from pool, or from the heap if
+ * pool is nullptr.
+*/
+PixelBuffer::PixelBuffer(int width, int height, const QColor& fillColor, FramePool* pool) :
+    width_(width),
+    height_(height),
+    data_(width*height*BYTES_PER_PIXEL, 0, PoolAllocator<uint8_t>(pool)){
+    fill(fillColor);
+}
+
+/*
+ * creates a copy of other whose memory comes from pool
+*/
+PixelBuffer::PixelBuffer(const PixelBuffer& other, FramePool* pool) :
+    width_(other.width_),
+    height_(other.height_),
+    data_(other.data_, PoolAllocator<uint8_t>(pool)){
+
+}
+
+/*
+ * returns the color of the pixel at the given row and column
+*/
+QColor PixelBuffer::pixel(int row, int col) const{
+    const uint8_t* p = constScanLine(row)+col*BYTES_PER_PIXEL;
+    return QColor(p[0], p[1], p[2], p[3]);
+}
+
+/*
+ * sets the color of the pixel at the given row and column
+*/
+void PixelBuffer::setPixel(int row, int col, const QColor& color){
+    uint8_t* p = scanLine(row)+col*BYTES_PER_PIXEL;
+    p[0] = color.red();
+    p[1] = color.green();
+    p[2] = color.blue();
+    p[3] = color.alpha();
+}
+
+/*
+ * returns the four bytes of the pixel at the given row and column as one value. two pixels have the same color
+ * exactly when their words are equal.
+*/
+uint32_t PixelBuffer::word(int row, int col) const{
+    uint32_t value;
+    memcpy(&value, constScanLine(row)+col*BYTES_PER_PIXEL, BYTES_PER_PIXEL);
+    return value;
+}
+
+/*
+ * writes a value returned by word() (or packColor()) back into the pixel at the given row and column
+*/
+void PixelBuffer::setWord(int row, int col, uint32_t value){
+    memcpy(scanLine(row)+col*BYTES_PER_PIXEL, &value, BYTES_PER_PIXEL);
+}
+
+/*
+ * sets every pixel in the buffer to the given color
+*/
+void PixelBuffer::fill(const QColor& color){
+    uint32_t value = packColor(color);
+    uint8_t* p = bits();
+    for(int i = 0; i < width_*height_; i++){
+        memcpy(p+i*BYTES_PER_PIXEL, &value, BYTES_PER_PIXEL);
+    }
+}
+
+/*
+ * converts a color into the value its four RGBA8 bytes have in memory
+*/
+uint32_t PixelBuffer::packColor(const QColor& color){
+    uint8_t bytes[BYTES_PER_PIXEL] = {(uint8_t)color.red(), (uint8_t)color.green(), (uint8_t)color.blue(), (uint8_t)color.alpha()};
+    uint32_t value;
+    memcpy(&value, bytes, BYTES_PER_PIXEL);
+    return value;
+}
+
+/*
+ * converts a value from packColor() or word() back into a color
+*/
+QColor PixelBuffer::unpackColor(uint32_t value){
+    uint8_t bytes[BYTES_PER_PIXEL];
+    memcpy(bytes, &value, BYTES_PER_PIXEL);
+    return QColor(bytes[0], bytes[1], bytes[2], bytes[3]);
+}
@@ -0,0 +1,69 @@
+/*
+ * pixelbuffer.h
+ * The PixelBuffer class stores the pixels of an image in one contiguous block of RGBA8 memory (4 bytes per pixel,
+ * rows laid out one after another), so whole-frame loops walk memory in order instead of chasing row pointers.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#ifndef PIXELBUFFER_H
+#define PIXELBUFFER_H
+
+#include <QColor>
+#include <vector>
+#include <stdint.h>
+#include "framepool.h"
+
+using namespace std;
+
+/*
+ * a run of pixels in one row, from column left up to (not including) column right
+*/
+struct PixelSpan{
+    int row;
+    int left;
+    int right;
+};
+
+class PixelBuffer{
+public:
+    static const int BYTES_PER_PIXEL = 4; //one byte each for red, green, blue and alpha
+
+    PixelBuffer(); //creates an empty buffer
+    PixelBuffer(int width, int height, const QColor& fillColor = QColor(255,255,255), FramePool* pool = nullptr); //creates a buffer filled with one color, in the pool if one is given (for frames)
+    PixelBuffer(const PixelBuffer& other, FramePool* pool); //copies a buffer into the pool (a plain copy is made on the heap)
+
+    int width() const {return width_;} //number of columns
+    int height() const {return height_;} //number of rows
+    int stride() const {return width_*BYTES_PER_PIXEL;} //number of bytes from the start of one row to the start of the next
+    int sizeInBytes() const {return height_*stride();} //total number of bytes of pixel data
+
+    QColor pixel(int row, int col) const; //gets the color at the given row and column
+    void setPixel(int row, int col, const QColor& color); //sets the color at the given row and column
+    uint32_t word(int row, int col) const; //gets the raw RGBA8 bytes of a pixel as one 32 bit value (for fast comparisons)
+    void setWord(int row, int col, uint32_t value); //sets the raw RGBA8 bytes of a pixel from a value returned by word()
+    void fill(const QColor& color); //sets every pixel to the given color
+
+    uint8_t* bits(){return data_.data();} //first byte of the pixel data
+    const uint8_t* constBits() const {return data_.data();}
+    uint8_t* scanLine(int row){return data_.data()+row*stride();} //first byte of the given row
+    const uint8_t* constScanLine(int row) const {return data_.data()+row*stride();}
+
+    static uint32_t packColor(const QColor& color); //converts a color into the raw value used by word() and setWord()
+    static QColor unpackColor(uint32_t value); //converts a raw value from word() back into a color
+
+    FramePool* pool() const {return data_.get_allocator().pool();} //pool the pixel data comes from, or nullptr for the heap
+
+private:
+    int width_; //number of columns
+    int height_; //number of rows
+    vector<uint8_t, PoolAllocator<uint8_t>> data_; //RGBA8 pixel data, row after row (the memory of a frame's pixels comes from the frame pool)
+};
+
+#endif // PIXELBUFFER_H
@@ -0,0 +1,251 @@
+/*
+ * pixelcanvas.cpp
+ * An implementation of the PixelCanvas class.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#include "pixelcanvas.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QImage>
+#include <utility>
+#include <string.h>
+
+PixelCanvas::PixelCanvas(QWidget *parent) :
+    QWidget(parent),
+    cellCount_(1),
+    lastCell_(-1, -1),
+    hoverCell_(-1, -1){
+    setAttribute(Qt::WA_OpaquePaintEvent); //every pixel of the widget is painted in paintEvent
+    setMouseTracking(true); //for cellHovered
+}
+
+/*
+ * replaces the displayed pixels with a copy of the given buffer
+*/
+void PixelCanvas::setPixels(const PixelBuffer& pixels){
+    pixels_ = pixels;
+    dirty_.resize(pixels_.width(), pixels_.height());
+    update();
+}
+
+/*
+ * replaces the displayed pixels with the given buffer, taking it over instead of copying it
+*/
+void PixelCanvas::setPixels(PixelBuffer&& pixels){
+    pixels_ = move(pixels);
+    dirty_.resize(pixels_.width(), pixels_.height());
+    update();
+}
+
+/*
+ * changes the color of one cell, marks it as dirty and schedules a repaint of only that cell. cells that are not shown
+ * are ignored, and so is setting a cell to the color it already has.
+*/
+void PixelCanvas::setPixel(int row, int col, const QColor& color){
+    if(row < 0 || col < 0 || row >= qMin(cellCount_, pixels_.height()) || col >= qMin(cellCount_, pixels_.width())){
+        return;
+    }
+    uint32_t value = PixelBuffer::packColor(color);
+    if(pixels_.word(row, col) == value){
+        return;
+    }
+    pixels_.setWord(row, col, value);
+    dirty_.mark(row, col);
+    update(cellRect(row, col));
+}
+
+/*
+ * paints over every cell in the spans with the compositor. like setPixel, cells that are not shown are skipped and only
+ * the cells whose color changes are marked dirty, but the whole change is repainted with a single update.
+*/
+void PixelCanvas::paintSpans(const vector<PixelSpan>& spans, const Compositor& compositor){
+    int cells = qMin(cellCount_, qMin(pixels_.width(), pixels_.height()));
+    vector<uint8_t> before; //the span before it was painted, to find the cells that changed
+    QRect changed;
+    for(const PixelSpan& span : spans){
+        int left = qMax(span.left, 0);
+        int right = qMin(span.right, cells);
+        if(span.row < 0 || span.row >= cells || left >= right){
+            continue;
+        }
+        uint8_t* line = pixels_.scanLine(span.row)+left*PixelBuffer::BYTES_PER_PIXEL;
+        before.assign(line, line+(right-left)*PixelBuffer::BYTES_PER_PIXEL);
+        compositor.compositeSpan(line, right-left);
+        for(int col = left; col < right; col++){
+            int offset = (col-left)*PixelBuffer::BYTES_PER_PIXEL;
+            if(memcmp(line+offset, before.data()+offset, PixelBuffer::BYTES_PER_PIXEL) != 0){
+                dirty_.mark(span.row, col);
+            }
+        }
+        changed = changed.united(QRect(left, span.row, right-left, 1));
+    }
+    updateCells(changed);
+}
+
+/*
+ * shows the spans in the given color on top of the pixels. only the cells under the old and new overlays are repainted.
+*/
+void PixelCanvas::setOverlay(const vector<PixelSpan>& spans, const QColor& color){
+    updateCells(overlayBounds_);
+    overlay_ = spans;
+    overlayColor_ = color;
+    overlayBounds_ = QRect();
+    for(const PixelSpan& span : overlay_){
+        overlayBounds_ = overlayBounds_.united(QRect(span.left, span.row, span.right-span.left, 1));
+    }
+    updateCells(overlayBounds_);
+}
+
+/*
+ * stops showing the overlay
+*/
+void PixelCanvas::clearOverlay(){
+    updateCells(overlayBounds_);
+    overlay_.clear();
+    overlayBounds_ = QRect();
+}
+
+/*
+ * changes how many rows (columns) of cells are shown
+*/
+void PixelCanvas::setCellCount(int cells){
+    cellCount_ = cells;
+    lastCell_ = QPoint(-1, -1);
+    update();
+}
+
+/*
+ * returns the area of the widget covered by the cell at the given row and column. cell edges are rounded so the
+ * cells always cover the whole widget even when its size is not a multiple of the number of cells.
+*/
+QRect PixelCanvas::cellRect(int row, int col) const{
+    int left = col*width()/cellCount_;
+    int top = row*height()/cellCount_;
+    int right = (col+1)*width()/cellCount_;
+    int bottom = (row+1)*height()/cellCount_;
+    return QRect(left, top, right-left, bottom-top);
+}
+
+/*
+ * schedules a repaint of the area of the widget covered by a rectangle of cells. an empty rectangle repaints nothing.
+*/
+void PixelCanvas::updateCells(const QRect& cells){
+    if(!cells.isEmpty()){
+        update(cellRect(cells.top(), cells.left()).united(cellRect(cells.bottom(), cells.right())));
+    }
+}
+
+/*
+ * returns the cell (x is the column, y is the row) under the given point, or (-1,-1) if the point is outside the grid
+*/
+QPoint PixelCanvas::cellAt(const QPoint& position) const{
+    if(position.x() < 0 || position.y() < 0 || position.x() >= width() || position.y() >= height()){
+        return QPoint(-1, -1);
+    }
+    return QPoint(position.x()*cellCount_/width(), position.y()*cellCount_/height());
+}
+
+/*
+ * paints the cells that intersect the area being repainted. the pixels are drawn as one scaled image wrapping the
+ * RGBA8 buffer (no copy), followed by the grid lines.
+*/
+void PixelCanvas::paintEvent(QPaintEvent *event){
+    QPainter painter(this);
+    painter.fillRect(event->rect(), Qt::white);
+    if(pixels_.width() == 0 || cellCount_ <= 0){
+        return;
+    }
+
+    //find the range of cells that need repainting
+    QRect dirty = event->rect().intersected(rect());
+    if(dirty.isEmpty()){
+        return;
+    }
+    QPoint first = cellAt(dirty.topLeft());
+    QPoint last = cellAt(dirty.bottomRight());
+    int cells = qMin(cellCount_, qMin(pixels_.width(), pixels_.height()));
+    int lastCol = qMin(last.x(), cells-1);
+    int lastRow = qMin(last.y(), cells-1);
+    if(first.x() > lastCol || first.y() > lastRow){
+        return;
+    }
+
+    QImage image(pixels_.constBits(), pixels_.width(), pixels_.height(), pixels_.stride(), QImage::Format_RGBA8888);
+    QRect target = cellRect(first.y(), first.x()).united(cellRect(lastRow, lastCol));
+    QRect source(first.x(), first.y(), lastCol-first.x()+1, lastRow-first.y()+1);
+    painter.drawImage(target, image, source);
+
+    //the overlay goes over the pixels and under the grid lines
+    for(const PixelSpan& span : overlay_){
+        if(span.row < first.y() || span.row > lastRow || span.right <= first.x() || span.left > lastCol){
+            continue;
+        }
+        int left = qMax(span.left, first.x());
+        int right = qMin(span.right-1, lastCol);
+        painter.fillRect(cellRect(span.row, left).united(cellRect(span.row, right)), overlayColor_);
+    }
+
+    //grid lines between the cells
+    painter.setPen(QColor(212, 212, 212));
+    for(int col = first.x(); col <= lastCol; col++){
+        QRect cell = cellRect(first.y(), col);
+        painter.drawLine(cell.right(), target.top(), cell.right(), target.bottom());
+    }
+    for(int row = first.y(); row <= lastRow; row++){
+        QRect cell = cellRect(row, first.x());
+        painter.drawLine(target.left(), cell.bottom(), target.right(), cell.bottom());
+    }
+}
+
+/*
+ * emits cellClicked for the cell under the mouse
+*/
+void PixelCanvas::mousePressEvent(QMouseEvent *event){
+    QPoint cell = cellAt(event->pos());
+    lastCell_ = cell;
+    if(cell.x() >= 0){
+        emit cellClicked(cell.y(), cell.x());
+    }
+}
+
+/*
+ * emits cellEntered each time the mouse is dragged into a different cell, and cellHovered each time it moves into a
+ * different cell without a button held down
+*/
+void PixelCanvas::mouseMoveEvent(QMouseEvent *event){
+    QPoint cell = cellAt(event->pos());
+    if(event->buttons() == Qt::NoButton){
+        if(cell != hoverCell_){
+            hoverCell_ = cell;
+            if(cell.x() >= 0){
+                emit cellHovered(cell.y(), cell.x());
+            }
+        }
+        return;
+    }
+    if(cell != lastCell_){
+        lastCell_ = cell;
+        if(cell.x() >= 0){
+            emit cellEntered(cell.y(), cell.x());
+        }
+    }
+}
+
+/*
+ * emits strokeFinished once all of the mouse buttons have been released
+*/
+void PixelCanvas::mouseReleaseEvent(QMouseEvent *event){
+    if(event->buttons() == Qt::NoButton){
+        lastCell_ = QPoint(-1, -1);
+        emit strokeFinished();
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ * pixelcanvas.h
+ * The PixelCanvas class is a widget that paints a PixelBuffer as a grid of square cells. It is used for both the
+ * frame editing area and the animation preview window. Changing a pixel only repaints the cell that changed, and the
+ * pixels are drawn as one scaled image instead of one widget item per cell, so large frames stay responsive.
+ * Pixels changed with setPixel are remembered in a DirtyRegion until clearDirty is called, so the owner of the canvas
+ * can copy just those pixels back into its frame. An overlay of spans can be drawn over the pixels without changing
+ * them, to preview a shape before it is drawn.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#ifndef PIXELCANVAS_H
+#define PIXELCANVAS_H
+
+#include <QWidget>
+#include <QColor>
+#include <QRect>
+#include <QPoint>
+#include <vector>
+#include "pixelbuffer.h"
+#include "dirtyregion.h"
+#include "compositor.h"
+
+class PixelCanvas : public QWidget{
+    Q_OBJECT
+
+public:
+    explicit PixelCanvas(QWidget *parent = nullptr);
+
+    void setPixels(const PixelBuffer& pixels); //shows a copy of the given pixels, repaints the whole canvas and clears the dirty region
+    void setPixels(PixelBuffer&& pixels); //shows the given pixels without copying them, repaints the whole canvas and clears the dirty region
+    const PixelBuffer& pixels() const {return pixels_;} //the pixels currently shown
+    QColor pixel(int row, int col) const {return pixels_.pixel(row, col);} //the color of one cell
+    void setPixel(int row, int col, const QColor& color); //changes the color of one cell, marks it dirty and repaints only that cell
+    void paintSpans(const vector<PixelSpan>& spans, const Compositor& compositor); //paints over runs of cells (which must not overlap), marks the changed ones dirty and repaints them with one update
+
+    const DirtyRegion& dirtyRegion() const {return dirty_;} //cells changed since the last clearDirty
+    void clearDirty() {dirty_.clear();} //called once the dirty cells have been saved
+
+    void setOverlay(const vector<PixelSpan>& spans, const QColor& color); //draws the spans in one color over the pixels (without changing them)
+    void clearOverlay(); //removes the overlay
+
+    void setCellCount(int cells); //sets the number of rows (columns) of cells shown, starting from the top left pixel
+    int cellCount() const {return cellCount_;}
+
+signals:
+    void cellClicked(int row, int col); //emitted when a mouse button is pressed over a cell
+    void cellEntered(int row, int col); //emitted when the mouse is dragged into a different cell with a button held down
+    void cellHovered(int row, int col); //emitted when the mouse moves into a different cell with no button held down
+    void strokeFinished(); //emitted when the mouse button is released, ending the operation that cellClicked started
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+
+private:
+    PixelBuffer pixels_; //pixels being displayed
+    DirtyRegion dirty_; //cells changed since they were last saved
+    int cellCount_; //number of rows (columns) of cells shown
+    QPoint lastCell_; //cell the mouse was last over while a button was held down (x is the column, y is the row)
+    QPoint hoverCell_; //cell the mouse was last over with no button held down
+    vector<PixelSpan> overlay_; //cells drawn over the pixels
+    QColor overlayColor_; //color of the overlay
+    QRect overlayBounds_; //smallest rectangle of cells containing the overlay (x is the column, y is the row)
+
+    QRect cellRect(int row, int col) const; //area of the widget covered by the given cell
+    void updateCells(const QRect& cells); //schedules a repaint of a rectangle of cells (x is the column, y is the row)
+    QPoint cellAt(const QPoint& position) const; //cell under a point in the widget, or (-1,-1) if there is none
+};
+
+#endif // PIXELCANVAS_H
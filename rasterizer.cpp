@@ -0,0 +1,185 @@
+/*
+ * rasterizer.cpp
+ * An implementation of the Rasterizer class.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#include "rasterizer.h"
+#include <algorithm>
+#include <stdlib.h>
+
+/*
+ * creates a rasterizer for a frame with size rows and columns
+*/
+Rasterizer::Rasterizer(int size) : size_(size), normalized_(true){
+
+}
+
+/*
+ * forgets the spans of every shape that was added
+*/
+void Rasterizer::clear(){
+    spans_.clear();
+    normalized_ = true;
+}
+
+/*
+ * adds the pixels of a row from left to right (both included), leaving out the part outside of the frame
+*/
+void Rasterizer::addSpan(int row, int left, int right){
+    if(row < 0 || row >= size_){
+        return;
+    }
+    left = max(left, 0);
+    right = min(right, size_-1);
+    if(left > right){
+        return;
+    }
+    spans_.push_back({row, left, right+1});
+    normalized_ = false;
+}
+
+/*
+ * adds a line with Bresenham's algorithm. every step moves to one of the eight neighbours of the last pixel, so the
+ * line has no gaps and no pixel is added twice.
+*/
+void Rasterizer::line(int row0, int col0, int row1, int col1){
+    int dCol = abs(col1-col0);
+    int dRow = -abs(row1-row0);
+    int stepCol = col0 < col1 ? 1 : -1;
+    int stepRow = row0 < row1 ? 1 : -1;
+    int error = dCol+dRow;
+    while(true){
+        plot(row0, col0);
+        if(row0 == row1 && col0 == col1){
+            break;
+        }
+        int error2 = 2*error;
+        if(error2 >= dRow){
+            error += dRow;
+            col0 += stepCol;
+        }
+        if(error2 <= dCol){
+            error += dCol;
+            row0 += stepRow;
+        }
+    }
+}
+
+/*
+ * adds a rectangle. a filled rectangle is one span per row; an outline is a span for the top and bottom rows and a
+ * pixel on each side of the rows between them.
+*/
+void Rasterizer::rectangle(int row0, int col0, int row1, int col1, bool filled){
+    int top = min(row0, row1);
+    int bottom = max(row0, row1);
+    int left = min(col0, col1);
+    int right = max(col0, col1);
+    if(filled){
+        for(int row = max(top, 0); row <= min(bottom, size_-1); row++){
+            addSpan(row, left, right);
+        }
+        return;
+    }
+    addSpan(top, left, right);
+    addSpan(bottom, left, right);
+    for(int row = max(top+1, 0); row <= min(bottom-1, size_-1); row++){
+        plot(row, left);
+        plot(row, right);
+    }
+}
+
+/*
+ * adds the ellipse that touches every side of the rectangle with corners at the two pixels, using Bresenham's
+ * midpoint method on the whole rectangle so that both even and odd sizes are symmetric. the four quadrants are drawn
+ * together, working from the left and right sides towards the middle; a filled ellipse is the span between the left
+ * and right quadrants on each row.
+*/
+void Rasterizer::ellipse(int row0, int col0, int row1, int col1, bool filled){
+    long long a = abs(col1-col0); //width and height, less one
+    long long b = abs(row1-row0);
+    long long b1 = b & 1;
+    long long dx = 4*(1-a)*b*b; //error increments
+    long long dy = 4*(b1+1)*a*a;
+    long long error = dx+dy+b1*a*a;
+
+    int left = min(col0, col1);
+    int right = left+int(a);
+    int lower = min(row0, row1)+int((b+1)/2); //the quadrants start from the middle rows and move out
+    int upper = lower-int(b1);
+    a = 8*a*a;
+    b1 = 8*b*b;
+
+    do{
+        if(filled){
+            addSpan(lower, left, right);
+            addSpan(upper, left, right);
+        }
+        else{
+            plot(lower, right);
+            plot(lower, left);
+            plot(upper, left);
+            plot(upper, right);
+        }
+        long long error2 = 2*error;
+        if(error2 <= dy){
+            lower++;
+            upper--;
+            dy += a;
+            error += dy;
+        }
+        if(error2 >= dx || 2*error > dy){
+            left++;
+            right--;
+            dx += b1;
+            error += dx;
+        }
+    }while(left <= right);
+
+    //very flat ellipses stop before reaching the top and bottom rows, which are finished here
+    while(lower-upper <= b){
+        addSpan(lower, left-1, filled ? right+1 : left-1);
+        addSpan(upper, left-1, filled ? right+1 : left-1);
+        if(!filled){
+            plot(lower, right+1);
+            plot(upper, right+1);
+        }
+        lower++;
+        upper--;
+    }
+}
+
+/*
+ * sorts the spans by row and column and merges the ones that overlap or touch, so that painting the spans visits
+ * each pixel once
+*/
+const vector<PixelSpan>& Rasterizer::spans(){
+    if(normalized_){
+        return spans_;
+    }
+    sort(spans_.begin(), spans_.end(), [](const PixelSpan& a, const PixelSpan& b){
+        return a.row != b.row ? a.row < b.row : a.left < b.left;
+    });
+    unsigned int merged = 0;
+    for(unsigned int i = 1; i < spans_.size(); i++){
+        PixelSpan& last = spans_[merged];
+        if(spans_[i].row == last.row && spans_[i].left <= last.right){
+            last.right = max(last.right, spans_[i].right);
+        }
+        else{
+            spans_[++merged] = spans_[i];
+        }
+    }
+    if(!spans_.empty()){
+        spans_.resize(merged+1);
+    }
+    normalized_ = true;
+    return spans_;
+}
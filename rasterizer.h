@@ -0,0 +1,45 @@
+/*
+ * rasterizer.h
+ * The Rasterizer class turns lines, rectangles and ellipses into the spans of pixels they cover, clipped to a square
+ * frame. It knows nothing about widgets or frames, so the same spans can be painted into a frame, shown as a preview
+ * over the edit canvas, or checked on their own. Shapes are given by two corners (or end points) in any order, and
+ * rectangles and ellipses can be outlined or filled.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <vector>
+#include "pixelbuffer.h"
+
+using namespace std;
+
+class Rasterizer{
+public:
+    Rasterizer(int size); //clips everything to the top left size x size pixels
+
+    void line(int row0, int col0, int row1, int col1); //adds a one pixel wide line between two pixels (both included)
+    void rectangle(int row0, int col0, int row1, int col1, bool filled); //adds a rectangle with opposite corners at the two pixels
+    void ellipse(int row0, int col0, int row1, int col1, bool filled); //adds the ellipse that fits in the rectangle with corners at the two pixels
+
+    const vector<PixelSpan>& spans(); //the pixels of everything added so far, sorted by row and column, with no pixel in two spans
+    void clear(); //forgets everything that was added
+
+private:
+    void addSpan(int row, int left, int right); //adds the pixels of a row from left to right (both included), clipped
+    void plot(int row, int col) {addSpan(row, col, col);} //adds one pixel
+
+    int size_; //number of rows (columns) shapes are clipped to
+    vector<PixelSpan> spans_; //spans added so far
+    bool normalized_; //true if spans_ is sorted and has no overlaps
+};
+
+#endif // RASTERIZER_H
@@ -0,0 +1,186 @@
+/*
+ * recolor.cpp
+ * An implementation of the Recolor class.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#include "recolor.h"
+#include "floodfill.h"
+#include <QtConcurrent>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+//an SSE2 version of the color matching is compiled when the target has SSE2 (every x86-64 CPU does)
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * returns true if every channel of the raw colors a and b differs by at most tolerance
+*/
+static inline bool closeColors(uint32_t a, uint32_t b, int tolerance){
+    if(a == b){
+        return true;
+    }
+    for(int shift = 0; shift < 32; shift += 8){
+        if(abs(int((a >> shift) & 0xff) - int((b >> shift) & 0xff)) > tolerance){
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * adds the pixel at col of a row to the runs, extending the last run if the pixel follows it
+*/
+static inline void addMatch(vector<PixelSpan>& runs, int col){
+    if(!runs.empty() && runs.back().right == col){
+        runs.back().right++;
+    }
+    else{
+        runs.push_back({0, col, col+1});
+    }
+}
+
+/*
+ * finds the runs of pixels in the count pixels of row that are close to from, replacing what runs held. with SSE2 four
+ * pixels are compared at a time: the channel differences are taken with saturating subtractions in both directions, and
+ * a pixel is close when none of its differences is left over after subtracting the tolerance.
+*/
+static void matchRow(const uint8_t* row, int count, uint32_t from, int tolerance, vector<PixelSpan>& runs){
+    runs.clear();
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i vfrom = _mm_set1_epi32(int(from));
+    const __m128i vtolerance = _mm_set1_epi8(char(tolerance));
+    const __m128i zero = _mm_setzero_si128();
+    for(; i+4 <= count; i += 4){
+        __m128i p = _mm_loadu_si128((const __m128i*)(row+i*PixelBuffer::BYTES_PER_PIXEL));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(p, vfrom), _mm_subs_epu8(vfrom, p));
+        __m128i close = _mm_cmpeq_epi32(_mm_subs_epu8(diff, vtolerance), zero);
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(close));
+        for(int bit = 0; mask != 0; bit++, mask >>= 1){
+            if(mask & 1){
+                addMatch(runs, i+bit);
+            }
+        }
+    }
+#endif
+    for(; i < count; i++){
+        uint32_t word;
+        memcpy(&word, row+i*PixelBuffer::BYTES_PER_PIXEL, PixelBuffer::BYTES_PER_PIXEL);
+        if(closeColors(word, from, tolerance)){
+            addMatch(runs, i);
+        }
+    }
+}
+
+/*
+ * creates an operation that recolors to the color to. what gets recolored is set with setFrom (Replace) or setSeed (Fill).
+*/
+Recolor::Recolor(Mode mode, const QColor& to, int frameSize) :
+    mode_(mode),
+    from_(0),
+    to_(PixelBuffer::packColor(to)),
+    frameSize_(frameSize),
+    seedRow_(0),
+    seedCol_(0),
+    tolerance_(0),
+    diagonal_(false),
+    compositor_(to){
+
+}
+
+/*
+ * recolors the frames from first to last (inclusive, clamped to the frames there are) on the global thread pool and
+ * waits for them. returns the number of frames that changed; the others still share their pixels with their copies.
+*/
+int Recolor::apply(vector<Frame>& frames, int first, int last) const{
+    first = max(first, 0);
+    last = min(last, int(frames.size())-1);
+    if(first > last){
+        return 0;
+    }
+    QAtomicInt changed(0);
+    QtConcurrent::blockingMap(frames.begin()+first, frames.begin()+last+1, ApplyToFrame(this, &changed));
+    return changed.load();
+}
+
+/*
+ * recolors one frame. the frame only reads its pixels until it is known that something changes, so frames without the
+ * color are not unshared.
+*/
+bool Recolor::applyToFrame(Frame& frame) const{
+    if(mode_ == Replace){
+        return replaceInFrame(frame);
+    }
+    return fillFrame(frame);
+}
+
+/*
+ * paints the fill color (with its alpha and blend mode) over every pixel close to from_. each row is painted in a copy
+ * first and only written back if some pixel of it changed, so a frame is only unshared when it really changes.
+*/
+bool Recolor::replaceInFrame(Frame& frame) const{
+    int rowSize = frameSize_*PixelBuffer::BYTES_PER_PIXEL;
+    vector<uint8_t> painted(rowSize);
+    vector<PixelSpan> runs;
+    bool changed = false;
+    for(int row = 0; row < frameSize_; row++){
+        const uint8_t* pixels = frame.pixels().constScanLine(row);
+        matchRow(pixels, frameSize_, from_, tolerance_, runs);
+        if(runs.empty()){
+            continue;
+        }
+        memcpy(painted.data(), pixels, rowSize);
+        for(const PixelSpan& run : runs){
+            compositor_.compositeSpan(painted.data()+run.left*PixelBuffer::BYTES_PER_PIXEL, run.right-run.left);
+        }
+        if(memcmp(painted.data(), pixels, rowSize) != 0){
+            memcpy(frame.editPixels().scanLine(row), painted.data(), rowSize);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/*
+ * fills the area connected to the seed cell, like the fill tool does on the current frame
+*/
+bool Recolor::fillFrame(Frame& frame) const{
+    if(seedRow_ < 0 || seedCol_ < 0 || seedRow_ >= frameSize_ || seedCol_ >= frameSize_){
+        return false;
+    }
+    const PixelBuffer& pixels = frame.pixels();
+    uint32_t seed = pixels.word(seedRow_, seedCol_);
+    if(tolerance_ == 0 && compositor_.composite(seed) == seed){
+        return false; //the area has one color, which painting over does not change
+    }
+
+    FloodFill fill(pixels, frameSize_);
+    fill.setTolerance(tolerance_);
+    fill.setDiagonal(diagonal_);
+    const vector<PixelSpan>& spans = fill.fill(seedRow_, seedCol_);
+    bool changes = false;
+    for(unsigned int i = 0; i < spans.size() && !changes; i++){
+        for(int col = spans[i].left; col < spans[i].right && !changes; col++){
+            uint32_t word = pixels.word(spans[i].row, col);
+            changes = compositor_.composite(word) != word;
+        }
+    }
+    if(!changes){
+        return false;
+    }
+
+    //the spans stay valid when the pixels are unshared, since they belong to the fill
+    compositor_.paintSpans(frame.editPixels(), spans);
+    return true;
+}
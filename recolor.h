@@ -0,0 +1,74 @@
+/*
+ * recolor.h
+ * The Recolor class paints the fill color (with its alpha and blend mode) over one color across many frames at once,
+ * either everywhere the color appears in a frame (replace color) or only in the area connected to one cell (the fill
+ * tool, on every frame). The frames are recolored in parallel, and in replace mode the rows are matched against the
+ * color several pixels at a time with SSE2. Frames the operation does not change keep sharing their pixels, so the
+ * whole operation can be kept in the undo history as one cheap step.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#ifndef RECOLOR_H
+#define RECOLOR_H
+
+#include <QAtomicInt>
+#include <QColor>
+#include <vector>
+#include <stdint.h>
+#include "frame.h"
+#include "compositor.h"
+
+using namespace std;
+
+class Recolor{
+public:
+    enum Mode{
+        Replace, //every pixel of the original color in the frame
+        Fill //the pixels connected to the seed cell that have its color, as the fill tool does
+    };
+
+    Recolor(Mode mode, const QColor& to, int frameSize); //recolors the top left frameSize x frameSize pixels of each frame to the color to
+
+    void setFrom(const QColor& from) {from_ = PixelBuffer::packColor(from);} //color that is replaced (Replace only)
+    void setSeed(int row, int col) {seedRow_ = row; seedCol_ = col;} //cell the fill starts from in every frame (Fill only)
+    void setTolerance(int tolerance) {tolerance_ = tolerance;} //largest difference in any channel that still counts as the same color (0 by default)
+    void setDiagonal(bool enabled) {diagonal_ = enabled;} //true if the fill spreads to diagonal neighbours (Fill only, off by default)
+    void setBlendMode(Compositor::BlendMode mode) {compositor_ = Compositor(PixelBuffer::unpackColor(to_), mode);} //how the fill color mixes with the pixels under it (normal by default)
+
+    int apply(vector<Frame>& frames, int first, int last) const; //recolors frames first to last (inclusive) in parallel, returns how many changed
+    bool applyToFrame(Frame& frame) const; //recolors one frame, returns true if it changed. safe to call on several frames at once
+
+private:
+    /*
+     * recolors one frame, for QtConcurrent::blockingMap
+    */
+    struct ApplyToFrame{
+        typedef void result_type;
+        const Recolor* recolor;
+        QAtomicInt* changed; //counts the frames that changed
+        ApplyToFrame(const Recolor* recolor, QAtomicInt* changed) : recolor(recolor), changed(changed){}
+        void operator()(Frame& frame) const {if(recolor->applyToFrame(frame)) changed->ref();}
+    };
+
+    bool replaceInFrame(Frame& frame) const; //Replace mode
+    bool fillFrame(Frame& frame) const; //Fill mode
+
+    Mode mode_; //what is recolored
+    uint32_t from_; //raw color being replaced
+    uint32_t to_; //raw color that is painted
+    int frameSize_; //number of rows (columns) of each frame that are recolored
+    int seedRow_; //cell the fill starts from
+    int seedCol_;
+    int tolerance_; //largest channel difference that is replaced
+    bool diagonal_; //true for 8-connected fills
+    Compositor compositor_; //paints the fill color over the matched pixels
+};
+
+#endif // RECOLOR_H
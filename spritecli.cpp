@@ -0,0 +1,202 @@
+/*
+ * spritecli.cpp
+ * The entrypoint for the command line tool, which converts sprite projects to animated GIFs or PNG sprite sheets (with
+ * a JSON file of where each frame is) without the editor. It uses no widgets and needs no display, so it can run on
+ * headless build machines. The projects are converted in parallel, each one on its own thread with its own Model.
+ *
+ * usage: spritecli [--format gif|png] [--output-dir dir] [--speed ms] [--alpha-threshold n] [--jobs n]
+ *                  [--padding n] [--no-trim] [--no-dedupe] files...
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QFuture>
+#include <QHash>
+#include <QList>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <stdio.h>
+#include <vector>
+#include "model.h"
+#include "gifexporter.h"
+#include "spritesheetexporter.h"
+
+using namespace std;
+
+/*
+ * what to make of each project
+*/
+struct ConvertOptions{
+    QString format; //"gif" or "png"
+    QString outputDir; //directory the converted files go to, or empty to put each one next to its project
+    int playbackSpeed; //milliseconds a frame without a duration of its own is shown for
+    int alphaThreshold; //pixels with a lower alpha are transparent (gifs only)
+    int padding; //pixels between the frames of a sprite sheet
+    bool trim; //true to trim the background around the frames of a sprite sheet
+    bool deduplicate; //true to store frames that look the same once in a sprite sheet
+};
+
+/*
+ * returns the name of the file the project fileName is converted to
+*/
+static QString outputFileName(const QString& fileName, const ConvertOptions& options){
+    QFileInfo info(fileName);
+    QDir dir = options.outputDir.isEmpty() ? info.dir() : QDir(options.outputDir);
+    return dir.filePath(info.completeBaseName() + "." + options.format);
+}
+
+/*
+ * converts one project. returns an empty string if it worked, or what went wrong.
+ * runs on a thread of the conversion pool, so it makes a model of its own.
+*/
+static QString convertProject(const QString& fileName, const ConvertOptions& options){
+    Model model;
+    vector<Frame> frames;
+    int frameSize = 0;
+    QString error;
+    if(!model.readProject(fileName, frames, frameSize, error)){
+        return QString("%1: %2").arg(fileName).arg(error);
+    }
+
+    QString outputName = outputFileName(fileName, options);
+    if(options.format == "png"){
+        SpriteSheetExporter exporter(frames, frameSize, options.playbackSpeed);
+        exporter.setPadding(options.padding);
+        exporter.setTrim(options.trim);
+        exporter.setDeduplicate(options.deduplicate);
+        if(!exporter.exportToFile(outputName)){
+            return QString("%1: %2").arg(fileName).arg(exporter.errorString());
+        }
+        return QString();
+    }
+
+    GifExporter exporter(frames, frameSize, options.playbackSpeed);
+    exporter.setAlphaThreshold(options.alphaThreshold);
+    if(!exporter.exportToFile(outputName)){
+        return QString("%1: %2").arg(fileName).arg(exporter.errorString());
+    }
+    return QString();
+}
+
+/*
+ * prints an error about the command line and returns the exit code for it
+*/
+static int usageError(const QString& message){
+    fprintf(stderr, "spritecli: %s\nTry 'spritecli --help' for more information.\n", qPrintable(message));
+    return 2;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("spritecli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts sprite projects (.ssp) to animated GIFs or PNG sprite sheets.");
+    parser.addHelpOption();
+    QCommandLineOption formatOption(QStringList() << "f" << "format",
+        "Format of the converted files: gif (an animation) or png (a sprite sheet). The default is gif.", "format", "gif");
+    QCommandLineOption outputOption(QStringList() << "o" << "output-dir",
+        "Directory for the converted files. By default each one goes next to its project.", "dir");
+    QCommandLineOption speedOption(QStringList() << "s" << "speed",
+        "Milliseconds a frame without a duration of its own is shown for. The default is 100.", "ms", "100");
+    QCommandLineOption alphaOption(QStringList() << "a" << "alpha-threshold",
+        "Pixels with a lower alpha are transparent in gifs (0 makes every pixel opaque). The default is 128.", "alpha", "128");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+        "Number of projects converted at the same time. The default is one for each core.", "count",
+        QString::number(QThread::idealThreadCount()));
+    QCommandLineOption paddingOption(QStringList() << "p" << "padding",
+        "Transparent pixels between the frames of a sprite sheet. The default is 1.", "pixels", "1");
+    QCommandLineOption noTrimOption("no-trim", "Keep the background around the frames of a sprite sheet.");
+    QCommandLineOption noDedupeOption("no-dedupe", "Store every frame of a sprite sheet, even ones that look the same.");
+    parser.addOption(formatOption);
+    parser.addOption(outputOption);
+    parser.addOption(speedOption);
+    parser.addOption(alphaOption);
+    parser.addOption(jobsOption);
+    parser.addOption(paddingOption);
+    parser.addOption(noTrimOption);
+    parser.addOption(noDedupeOption);
+    parser.addPositionalArgument("files", "Sprite projects to convert.", "files...");
+    parser.process(a);
+
+    ConvertOptions options;
+    options.format = parser.value(formatOption).toLower();
+    options.outputDir = parser.value(outputOption);
+    bool speedOk, alphaOk, jobsOk, paddingOk;
+    options.playbackSpeed = parser.value(speedOption).toInt(&speedOk);
+    options.alphaThreshold = parser.value(alphaOption).toInt(&alphaOk);
+    int jobs = parser.value(jobsOption).toInt(&jobsOk);
+    options.padding = parser.value(paddingOption).toInt(&paddingOk);
+    options.trim = !parser.isSet(noTrimOption);
+    options.deduplicate = !parser.isSet(noDedupeOption);
+    QStringList files = parser.positionalArguments();
+
+    if(options.format != "gif" && options.format != "png"){
+        return usageError(QString("unknown format '%1'").arg(options.format));
+    }
+    if(!speedOk || options.playbackSpeed <= 0){
+        return usageError("the speed must be a positive number of milliseconds");
+    }
+    if(!alphaOk || options.alphaThreshold < 0 || options.alphaThreshold > 256){
+        return usageError("the alpha threshold must be between 0 and 256");
+    }
+    if(!jobsOk || jobs <= 0){
+        return usageError("the number of jobs must be positive");
+    }
+    if(!paddingOk || options.padding < 0){
+        return usageError("the padding cannot be negative");
+    }
+    if(files.isEmpty()){
+        return usageError("no projects to convert");
+    }
+
+    //the projects are converted at the same time, so two of them must not be written to the same file
+    QHash<QString, QString> projectsByOutput;
+    for(const QString& fileName : files){
+        QString outputName = QDir::cleanPath(QFileInfo(outputFileName(fileName, options)).absoluteFilePath());
+        if(projectsByOutput.contains(outputName)){
+            return usageError(QString("%1 and %2 would both be converted to %3")
+                              .arg(projectsByOutput.value(outputName)).arg(fileName).arg(outputName));
+        }
+        projectsByOutput.insert(outputName, fileName);
+    }
+    if(!options.outputDir.isEmpty() && !QDir().mkpath(options.outputDir)){
+        fprintf(stderr, "spritecli: could not create %s\n", qPrintable(options.outputDir));
+        return 1;
+    }
+
+    //the projects are converted on a pool of their own. each gif export waits for its frames to be encoded on the
+    //global pool, which could never happen if the conversions took up all of its threads themselves.
+    QThreadPool conversionPool;
+    conversionPool.setMaxThreadCount(jobs);
+    QList<QFuture<QString>> conversions;
+    for(const QString& fileName : files){
+        conversions.append(QtConcurrent::run(&conversionPool, convertProject, fileName, options));
+    }
+
+    //results are reported in the order of the files on the command line
+    int failures = 0;
+    for(int i = 0; i < conversions.size(); i++){
+        QString error = conversions[i].result();
+        if(error.isEmpty()){
+            printf("%s -> %s\n", qPrintable(files[i]), qPrintable(outputFileName(files[i], options)));
+        }
+        else{
+            fprintf(stderr, "spritecli: %s\n", qPrintable(error));
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
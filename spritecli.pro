@@ -0,0 +1,43 @@
+#-------------------------------------------------
+#
+# Command line tool that converts sprite projects to GIFs and
+# sprite sheets without the editor (see spritecli.cpp).
+# It links no widgets and needs no display server.
+#
+#-------------------------------------------------
+
+QT       += core gui concurrent
+QT       -= widgets
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = spritecli
+TEMPLATE = app
+
+# keep an in-source build from overwriting the editor's Makefile and objects
+MAKEFILE = Makefile.spritecli
+OBJECTS_DIR = spritecli-build
+MOC_DIR = spritecli-build
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+        spritecli.cpp \
+    model.cpp \
+    frame.cpp \
+    pixelbuffer.cpp \
+    framepool.cpp \
+    ssptextreader.cpp \
+    gifexporter.cpp \
+    spritesheetexporter.cpp
+
+HEADERS += \
+    model.h \
+    frame.h \
+    gif.h \
+    pixelbuffer.h \
+    framepool.h \
+    ssptextreader.h \
+    gifexporter.h \
+    spritesheetexporter.h
@@ -0,0 +1,363 @@
+/*
+ * spritesheetexporter.cpp
+ * An implementation of the SpriteSheetExporter class.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#include "spritesheetexporter.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+/*
+ * creates an exporter for a snapshot of the frames. copying the frames only shares their pixels.
+*/
+SpriteSheetExporter::SpriteSheetExporter(const vector<Frame>& frames, int frameSize, int playbackSpeed, QObject* parent) :
+    QObject(parent),
+    frames_(frames),
+    frameSize_(frameSize),
+    playbackSpeed_(playbackSpeed),
+    trim_(true),
+    deduplicate_(true),
+    padding_(1),
+    background_(PixelBuffer::packColor(QColor(255, 255, 255))),
+    packed_(false),
+    atlasWidth_(0),
+    atlasHeight_(0),
+    canceled_(0){
+
+}
+
+/*
+ * asks the export to stop. it stops between frames and before writing anything, so no files are left half written.
+*/
+void SpriteSheetExporter::cancel(){
+    canceled_.storeRelease(1);
+}
+
+/*
+ * reports that completed steps of the export are done. each frame is a step while packing, then each sprite while the
+ * atlas is made, then one last step for writing the files. the number of sprites is only known after packing, so until
+ * then it counts as one per frame.
+*/
+void SpriteSheetExporter::reportProgress(int completed){
+    int sprites = packed_ ? sprites_.size() : frames_.size();
+    emit progressChanged(completed, frames_.size()+sprites+1);
+}
+
+/*
+ * returns the name of the json file that goes with the atlas imageFileName: the same name with .json instead of .png
+*/
+QString SpriteSheetExporter::metadataFileName(const QString& imageFileName){
+    QFileInfo info(imageFileName);
+    return info.dir().filePath(info.completeBaseName() + ".json");
+}
+
+/*
+ * returns the milliseconds frame index is shown for. frames without a duration of their own use the playback speed.
+*/
+int SpriteSheetExporter::frameDuration(int index) const{
+    return frames_[index].duration() > 0 ? frames_[index].duration() : playbackSpeed_;
+}
+
+/*
+ * finds the smallest rectangle (left and top inclusive, right and bottom exclusive) of frame index that holds every
+ * pixel that is neither transparent nor the background color. a frame that is all background keeps its top left pixel,
+ * so that every frame has a picture.
+*/
+void SpriteSheetExporter::trimFrame(int index, int& left, int& top, int& right, int& bottom) const{
+    left = 0;
+    top = 0;
+    right = frameSize_;
+    bottom = frameSize_;
+    if(!trim_){
+        return;
+    }
+
+    const PixelBuffer& pixels = frames_[index].pixels();
+    left = frameSize_;
+    right = 0;
+    bottom = 0;
+    for(int row = 0; row < frameSize_; row++){
+        for(int col = 0; col < frameSize_; col++){
+            uint32_t word = pixels.word(row, col);
+            if(word == background_ || pixels.constScanLine(row)[col*PixelBuffer::BYTES_PER_PIXEL+3] == 0){
+                continue;
+            }
+            if(bottom == 0){
+                top = row;
+            }
+            bottom = row+1;
+            left = min(left, col);
+            right = max(right, col+1);
+        }
+    }
+    if(bottom == 0){
+        left = 0;
+        top = 0;
+        right = 1;
+        bottom = 1;
+    }
+}
+
+/*
+ * returns the size and pixels of a rectangle of frame index. two rectangles with the same key look the same.
+*/
+QByteArray SpriteSheetExporter::spriteKey(int index, int left, int top, int width, int height) const{
+    const PixelBuffer& pixels = frames_[index].pixels();
+    int rowSize = width*PixelBuffer::BYTES_PER_PIXEL;
+    QByteArray key;
+    key.reserve(8+rowSize*height);
+    key.append(reinterpret_cast<const char*>(&width), sizeof(width));
+    key.append(reinterpret_cast<const char*>(&height), sizeof(height));
+    for(int row = top; row < top+height; row++){
+        key.append(reinterpret_cast<const char*>(pixels.constScanLine(row)+left*PixelBuffer::BYTES_PER_PIXEL), rowSize);
+    }
+    return key;
+}
+
+/*
+ * works out the picture of every frame and where the pictures go in the atlas. frames that share their pixels (copies
+ * of each other) are recognized without looking at the pixels; other frames are compared by their trimmed pixels.
+*/
+void SpriteSheetExporter::pack(){
+    if(packed_){
+        return;
+    }
+    sprites_.clear();
+    frameEntries_.clear();
+    QHash<QByteArray, int> spritesByKey; //index in sprites_ of each distinct picture
+    QHash<const void*, int> entriesByVersion; //index in frameEntries_ of the first frame with each shared pixel buffer
+
+    for(unsigned int i = 0; i < frames_.size() && !canceled_.loadAcquire(); i++){
+        reportProgress(i+1);
+        FrameEntry entry;
+        if(deduplicate_ && entriesByVersion.contains(frames_[i].version())){
+            entry = frameEntries_[entriesByVersion.value(frames_[i].version())];
+            frameEntries_.push_back(entry);
+            continue;
+        }
+
+        int left, top, right, bottom;
+        trimFrame(i, left, top, right, bottom);
+        entry.sourceX = left;
+        entry.sourceY = top;
+        entry.sprite = -1;
+        QByteArray key;
+        if(deduplicate_){
+            key = spriteKey(i, left, top, right-left, bottom-top);
+            entry.sprite = spritesByKey.value(key, -1);
+        }
+        if(entry.sprite < 0){
+            Sprite sprite;
+            sprite.frame = i;
+            sprite.sourceX = left;
+            sprite.sourceY = top;
+            sprite.width = right-left;
+            sprite.height = bottom-top;
+            sprite.x = 0;
+            sprite.y = 0;
+            entry.sprite = sprites_.size();
+            sprites_.push_back(sprite);
+            if(deduplicate_){
+                spritesByKey.insert(key, entry.sprite);
+            }
+        }
+        if(deduplicate_){
+            entriesByVersion.insert(frames_[i].version(), frameEntries_.size());
+        }
+        frameEntries_.push_back(entry);
+    }
+    if(canceled_.loadAcquire()){
+        return;
+    }
+
+    placeSprites();
+    packed_ = true;
+}
+
+/*
+ * places the sprites with a skyline bottom-left packer. the atlas is as wide as the smallest power of two that fits the
+ * widest sprite and would make a square of the sprites' total area; the sprites go in tallest first, each one wherever
+ * its top ends up lowest, and the atlas is as tall as the highest sprite.
+*/
+void SpriteSheetExporter::placeSprites(){
+    vector<int> order(sprites_.size());
+    int area = 0;
+    int widest = 0;
+    for(unsigned int i = 0; i < sprites_.size(); i++){
+        order[i] = i;
+        area += (sprites_[i].width+padding_)*(sprites_[i].height+padding_);
+        widest = max(widest, sprites_[i].width+padding_);
+    }
+    stable_sort(order.begin(), order.end(), [this](int a, int b){
+        if(sprites_[a].height != sprites_[b].height){
+            return sprites_[a].height > sprites_[b].height;
+        }
+        return sprites_[a].width > sprites_[b].width;
+    });
+
+    atlasWidth_ = 1;
+    while(atlasWidth_ < max(widest, int(ceil(sqrt(double(area)))))){
+        atlasWidth_ *= 2;
+    }
+    atlasHeight_ = 0;
+
+    vector<SkylineSegment> skyline;
+    skyline.push_back({0, 0, atlasWidth_});
+    for(int index : order){
+        Sprite& sprite = sprites_[index];
+        int width = sprite.width+padding_;
+        int height = sprite.height+padding_;
+
+        //the lowest spot where the sprite fits on top of the skyline (leftmost of the lowest)
+        int bestSegment = -1;
+        int bestY = 0;
+        for(unsigned int i = 0; i < skyline.size() && skyline[i].x+width <= atlasWidth_; i++){
+            int y = 0;
+            int covered = 0;
+            for(unsigned int j = i; covered < width; j++){
+                y = max(y, skyline[j].y);
+                covered += skyline[j].width;
+            }
+            if(bestSegment < 0 || y < bestY){
+                bestSegment = i;
+                bestY = y;
+            }
+        }
+
+        sprite.x = skyline[bestSegment].x;
+        sprite.y = bestY;
+        atlasHeight_ = max(atlasHeight_, sprite.y+sprite.height);
+
+        //raise the skyline under the sprite: the new step replaces the steps it covers and cuts into the last one
+        SkylineSegment step = {sprite.x, bestY+height, width};
+        skyline.insert(skyline.begin()+bestSegment, step);
+        unsigned int next = bestSegment+1;
+        while(next < skyline.size() && skyline[next].x < step.x+step.width){
+            int overlap = step.x+step.width-skyline[next].x;
+            if(overlap >= skyline[next].width){
+                skyline.erase(skyline.begin()+next);
+            }
+            else{
+                skyline[next].x += overlap;
+                skyline[next].width -= overlap;
+                break;
+            }
+        }
+
+        //merge steps of the same height so later searches have fewer steps to look at
+        for(unsigned int i = 0; i+1 < skyline.size();){
+            if(skyline[i].y == skyline[i+1].y){
+                skyline[i].width += skyline[i+1].width;
+                skyline.erase(skyline.begin()+i+1);
+            }
+            else{
+                i++;
+            }
+        }
+    }
+}
+
+/*
+ * returns the atlas: every distinct picture at its place, on a transparent background. a canceled export returns a
+ * null image.
+*/
+QImage SpriteSheetExporter::image(){
+    pack();
+    if(!packed_){
+        return QImage();
+    }
+    QImage atlas(atlasWidth_, max(atlasHeight_, 1), QImage::Format_RGBA8888);
+    atlas.fill(Qt::transparent);
+    for(unsigned int i = 0; i < sprites_.size(); i++){
+        if(canceled_.loadAcquire()){
+            return QImage();
+        }
+        reportProgress(frames_.size()+i+1);
+        const Sprite& sprite = sprites_[i];
+        const PixelBuffer& pixels = frames_[sprite.frame].pixels();
+        int rowSize = sprite.width*PixelBuffer::BYTES_PER_PIXEL;
+        for(int row = 0; row < sprite.height; row++){
+            memcpy(atlas.scanLine(sprite.y+row) + sprite.x*PixelBuffer::BYTES_PER_PIXEL,
+                   pixels.constScanLine(sprite.sourceY+row) + sprite.sourceX*PixelBuffer::BYTES_PER_PIXEL, rowSize);
+        }
+    }
+    return atlas;
+}
+
+/*
+ * returns the json for the atlas, in the common "frames array" layout that game engines and sprite tools read: for each
+ * frame, its rectangle in the atlas, where that rectangle goes in the untrimmed frame, and its duration.
+*/
+QByteArray SpriteSheetExporter::metadata(const QString& imageName){
+    pack();
+    QJsonArray frames;
+    for(unsigned int i = 0; i < frameEntries_.size(); i++){
+        const FrameEntry& entry = frameEntries_[i];
+        const Sprite& sprite = sprites_[entry.sprite];
+        QJsonObject rect{{"x", sprite.x}, {"y", sprite.y}, {"w", sprite.width}, {"h", sprite.height}};
+        QJsonObject sourceRect{{"x", entry.sourceX}, {"y", entry.sourceY}, {"w", sprite.width}, {"h", sprite.height}};
+        QJsonObject frame{
+            {"filename", QString("frame %1").arg(i)},
+            {"frame", rect},
+            {"rotated", false},
+            {"trimmed", sprite.width != frameSize_ || sprite.height != frameSize_},
+            {"spriteSourceSize", sourceRect},
+            {"sourceSize", QJsonObject{{"w", frameSize_}, {"h", frameSize_}}},
+            {"duration", frameDuration(i)}
+        };
+        frames.append(frame);
+    }
+    QJsonObject meta{
+        {"app", "A7 Sprite Editor"},
+        {"image", imageName},
+        {"format", "RGBA8888"},
+        {"size", QJsonObject{{"w", atlasWidth_}, {"h", max(atlasHeight_, 1)}}},
+        {"scale", "1"}
+    };
+    QJsonObject root{{"frames", frames}, {"meta", meta}};
+    return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+/*
+ * writes the atlas to imageFileName as a png and its metadata next to it. returns false and sets errorString if either
+ * file could not be written, or returns false with no error if the export was canceled before anything was written.
+ * this blocks until the export is finished, so run it off the gui thread.
+*/
+bool SpriteSheetExporter::exportToFile(const QString& imageFileName){
+    error_.clear();
+    QImage atlas = image();
+    if(atlas.isNull()){
+        return false;
+    }
+    if(!atlas.save(imageFileName, "PNG")){
+        error_ = QCoreApplication::translate("SpriteSheetExporter", "Could not write %1").arg(imageFileName);
+        return false;
+    }
+
+    QString jsonFileName = metadataFileName(imageFileName);
+    QSaveFile file(jsonFileName);
+    QByteArray json = metadata(QFileInfo(imageFileName).fileName());
+    if(!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()){
+        error_ = QCoreApplication::translate("SpriteSheetExporter", "Could not write %1: %2").arg(jsonFileName).arg(file.errorString());
+        return false;
+    }
+    reportProgress(frames_.size()+sprites_.size()+1);
+    return true;
+}
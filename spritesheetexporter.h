@@ -0,0 +1,104 @@
+/*
+ * spritesheetexporter.h
+ * The SpriteSheetExporter class packs the frames of a sprite into one PNG texture atlas, plus a JSON file with the
+ * rectangle and duration of every frame, which is how game engines like to load sprites. Each frame can be trimmed to
+ * the pixels that are not background, frames that look the same are stored only once, and the sprites are placed with
+ * a skyline bin packer so the atlas stays small. An export can run on another thread, reporting its progress and
+ * stopping when it is canceled.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#ifndef SPRITESHEETEXPORTER_H
+#define SPRITESHEETEXPORTER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QColor>
+#include <QImage>
+#include <QString>
+#include <vector>
+#include <stdint.h>
+#include "frame.h"
+
+using namespace std;
+
+class SpriteSheetExporter : public QObject{
+    Q_OBJECT
+
+public:
+    SpriteSheetExporter(const vector<Frame>& frames, int frameSize, int playbackSpeed, QObject* parent = nullptr); //packs the top left frameSize x frameSize pixels of each frame, giving frames without a duration playbackSpeed milliseconds
+
+    void setTrim(bool enabled) {trim_ = enabled; packed_ = false;} //cut away the background around each frame (on by default)
+    void setDeduplicate(bool enabled) {deduplicate_ = enabled; packed_ = false;} //store frames that look the same only once (on by default)
+    void setPadding(int padding) {padding_ = padding; packed_ = false;} //transparent pixels between the sprites in the atlas (1 by default)
+    void setBackground(const QColor& color) {background_ = PixelBuffer::packColor(color); packed_ = false;} //color trimmed away along with transparent pixels (white by default, like a new frame)
+
+    bool exportToFile(const QString& imageFileName); //writes the atlas to imageFileName and its metadata to metadataFileName(imageFileName). returns false if it failed or was canceled
+    QImage image(); //packs the frames and returns the atlas
+    QByteArray metadata(const QString& imageName); //packs the frames and returns the json that goes with the atlas (saved as imageName)
+    QString errorString() const {return error_;} //why the last export failed (empty if it was canceled)
+    void cancel(); //asks the export in progress to stop. safe to call from any thread
+    static QString metadataFileName(const QString& imageFileName); //the json file written next to an atlas (same name, .json)
+
+signals:
+    void progressChanged(int completed, int total); //emitted from the exporting thread as frames are packed and copied into the atlas
+
+private:
+    /*
+     * one distinct picture in the atlas
+    */
+    struct Sprite{
+        int frame; //first frame that shows this picture
+        int sourceX, sourceY; //top left corner of the picture in that frame
+        int width, height; //size of the picture
+        int x, y; //top left corner of the picture in the atlas
+    };
+
+    /*
+     * where one frame's picture is
+    */
+    struct FrameEntry{
+        int sprite; //index in sprites_
+        int sourceX, sourceY; //top left corner of the picture in the frame
+    };
+
+    /*
+     * one step of the skyline: the atlas is full below y from x to x+width
+    */
+    struct SkylineSegment{
+        int x, y, width;
+    };
+
+    void pack(); //trims, deduplicates and places the frames (does nothing if they already are, stops early if canceled)
+    void trimFrame(int index, int& left, int& top, int& right, int& bottom) const; //finds the rectangle of a frame that is not background
+    QByteArray spriteKey(int index, int left, int top, int width, int height) const; //the pixels of a rectangle, for finding frames that look the same
+    void placeSprites(); //packs sprites_ into the atlas, setting their positions and the atlas size
+    int frameDuration(int index) const; //milliseconds frame index is shown for
+    void reportProgress(int completed); //emits progressChanged with the steps done out of the frames, the sprites and the writing
+
+    vector<Frame> frames_; //frames to export (shared with the caller's frames)
+    int frameSize_; //number of rows (columns) of each frame that are exported
+    int playbackSpeed_; //milliseconds a frame without a duration of its own is shown for
+    bool trim_; //true to trim the background around the frames
+    bool deduplicate_; //true to store frames that look the same once
+    int padding_; //pixels between sprites
+    uint32_t background_; //raw color (see PixelBuffer::word) trimmed away
+
+    bool packed_; //true once sprites_ and frameEntries_ are up to date
+    vector<Sprite> sprites_; //the distinct pictures, in the order they were first seen
+    vector<FrameEntry> frameEntries_; //the picture of each frame
+    int atlasWidth_; //size of the atlas in pixels
+    int atlasHeight_;
+    QAtomicInt canceled_; //set to 1 by cancel
+    QString error_; //description of the last failure
+};
+
+#endif // SPRITESHEETEXPORTER_H
@@ -0,0 +1,121 @@
+/*
+ * ssptextreader.cpp
+ * An implementation of the SspTextReader class.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#include "ssptextreader.h"
+
+/*
+ * creates a reader for an open device. nothing is read until the first number is requested.
+*/
+SspTextReader::SspTextReader(QIODevice* device) :
+    device_(device),
+    block_(BLOCK_SIZE),
+    pos_(nullptr),
+    end_(nullptr),
+    line_(1){
+
+}
+
+/*
+ * replaces the block with the next part of the file
+*/
+bool SspTextReader::fill(){
+    qint64 bytesRead = device_->read(block_.data(), block_.size());
+    if(bytesRead <= 0){
+        pos_ = end_ = nullptr;
+        return false;
+    }
+    pos_ = block_.data();
+    end_ = pos_+bytesRead;
+    return true;
+}
+
+/*
+ * moves past any spaces, tabs and line breaks before the next word
+*/
+bool SspTextReader::skipSpace(){
+    while(true){
+        if(pos_ == end_ && !fill()){
+            return false;
+        }
+        char c = *pos_;
+        if(c == '\n'){
+            line_++;
+        }
+        else if(c != ' ' && c != '\t' && c != '\r'){
+            return true;
+        }
+        pos_++;
+    }
+}
+
+/*
+ * reads the next number (a run of digits, possibly split across two blocks) into value
+*/
+bool SspTextReader::readInt(int& value){
+    if(!skipSpace()){
+        error_ = QString("unexpected end of file");
+        return false;
+    }
+
+    bool negative = (*pos_ == '-');
+    if(negative){
+        pos_++;
+        if(pos_ == end_){
+            fill();
+        }
+    }
+
+    int digits = 0;
+    long long number = 0;
+    while(pos_ != end_ || fill()){
+        char c = *pos_;
+        if(c < '0' || c > '9'){
+            break;
+        }
+        if(number <= 2147483647LL){ //keep counting digits but stop growing once the value cannot fit
+            number = number*10+(c-'0');
+        }
+        digits++;
+        pos_++;
+    }
+
+    if(digits == 0 || (pos_ != end_ && *pos_ != ' ' && *pos_ != '\t' && *pos_ != '\r' && *pos_ != '\n')){
+        error_ = (pos_ == end_) ? QString("unexpected end of file")
+                                : QString("expected a number but found '%1'").arg(QChar(*pos_));
+        return false;
+    }
+    if(number > 2147483647LL){
+        error_ = QString("number is too large");
+        return false;
+    }
+    value = negative ? -int(number) : int(number);
+    return true;
+}
+
+/*
+ * reads count color channel values, each from 0 to 255, and stores them one per byte starting at channels
+*/
+bool SspTextReader::readChannels(uint8_t* channels, int count){
+    for(int i = 0; i < count; i++){
+        int value;
+        if(!readInt(value)){
+            return false;
+        }
+        if(value < 0 || value > 255){
+            error_ = QString("color value %1 is not between 0 and 255").arg(value);
+            return false;
+        }
+        channels[i] = uint8_t(value);
+    }
+    return true;
+}
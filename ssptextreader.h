@@ -0,0 +1,50 @@
+/*
+ * ssptextreader.h
+ * The SspTextReader class reads the numbers of a project saved in the original text .ssp format. It reads the file
+ * in large blocks and parses the digits straight out of the block, so no strings are made for lines or numbers, and
+ * pixel values go directly into the memory of a frame. It keeps track of the line it is on for error messages.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#ifndef SSPTEXTREADER_H
+#define SSPTEXTREADER_H
+
+#include <QIODevice>
+#include <QString>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+class SspTextReader{
+public:
+    static const int BLOCK_SIZE = 64*1024; //number of bytes read from the file at a time
+
+    explicit SspTextReader(QIODevice* device); //reads from an open device
+
+    bool readInt(int& value); //reads the next number. returns false at the end of the file or if the next word is not a number
+    bool readChannels(uint8_t* channels, int count); //reads count numbers from 0 to 255 into consecutive bytes
+
+    int lineNumber() const {return line_;} //line (counting from 1) of the last character read
+    QString errorString() const {return error_;} //why the last read failed
+
+private:
+    bool fill(); //reads the next block of the file. returns false at the end of the file
+    bool skipSpace(); //moves past spaces and line breaks. returns false if the file ends first
+
+    QIODevice* device_; //file being read
+    vector<char> block_; //last block read from the file
+    const char* pos_; //next character to parse in block_
+    const char* end_; //one past the last character read into block_
+    int line_; //current line number
+    QString error_; //description of the last failure
+};
+
+#endif // SSPTEXTREADER_H
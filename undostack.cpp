@@ -0,0 +1,253 @@
+/*
+ * undostack.cpp
+ * An implementation of the UndoStack, PixelEditCommand, ProjectCommand and FrameDurationCommand classes.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#include "undostack.h"
+
+/*
+ * records that one pixel of a frame went from before to after. a pixel may be recorded more than once; undo and
+ * redo replay the changes in the right order.
+*/
+void PixelEditCommand::record(int frame, int row, int col, uint32_t before, uint32_t after){
+    PixelChange change;
+    change.frame = frame;
+    change.row = row;
+    change.col = col;
+    change.before = before;
+    change.after = after;
+    changes_.push_back(change);
+}
+
+/*
+ * restores the old value of every changed pixel, newest change first, and goes back to the frame that was edited
+*/
+void PixelEditCommand::undo(ProjectState& project){
+    for(auto change = changes_.rbegin(); change != changes_.rend(); ++change){
+        project.frames[change->frame].editPixels().setWord(change->row, change->col, change->before);
+    }
+    project.currentFrame = currentFrame_;
+}
+
+/*
+ * writes the new value of every changed pixel, oldest change first, and goes back to the frame that was edited
+*/
+void PixelEditCommand::redo(ProjectState& project){
+    for(const PixelChange& change : changes_){
+        project.frames[change.frame].editPixels().setWord(change.row, change.col, change.after);
+    }
+    project.currentFrame = currentFrame_;
+}
+
+/*
+ * the command costs its own size plus one entry per changed pixel
+*/
+size_t PixelEditCommand::memoryCost() const{
+    return sizeof(*this) + changes_.capacity()*sizeof(PixelChange);
+}
+
+/*
+ * remembers the project before and after a structural change
+*/
+ProjectCommand::ProjectCommand(const ProjectState& before, const ProjectState& after) :
+    before_(before),
+    after_(after){
+
+}
+
+/*
+ * the command costs its own size plus one frame handle per frame in each state. the pixels of those frames are
+ * counted by the stack, which knows which of them the project still shares.
+*/
+size_t ProjectCommand::memoryCost() const{
+    return sizeof(*this) + (before_.frames.size()+after_.frames.size())*sizeof(Frame);
+}
+
+/*
+ * adds the frames of both states
+*/
+void ProjectCommand::collectFrames(vector<const Frame*>& frames) const{
+    for(const Frame& frame : before_.frames){
+        frames.push_back(&frame);
+    }
+    for(const Frame& frame : after_.frames){
+        frames.push_back(&frame);
+    }
+}
+
+/*
+ * puts back the frames, current frame and frame size from before the change
+*/
+void ProjectCommand::undo(ProjectState& project){
+    project = before_;
+}
+
+/*
+ * puts back the frames, current frame and frame size from after the change
+*/
+void ProjectCommand::redo(ProjectState& project){
+    project = after_;
+}
+
+/*
+ * puts back the old duration and goes back to the frame
+*/
+void FrameDurationCommand::undo(ProjectState& project){
+    project.frames[frame_].setDuration(before_);
+    project.currentFrame = frame_;
+}
+
+/*
+ * puts back the new duration and goes back to the frame
+*/
+void FrameDurationCommand::redo(ProjectState& project){
+    project.frames[frame_].setDuration(after_);
+    project.currentFrame = frame_;
+}
+
+/*
+ * takes in a later change to the duration of the same frame made by the same use of the spin box, so stepping the
+ * duration from 100 to 500 milliseconds is undone in one step
+*/
+bool FrameDurationCommand::mergeWith(const UndoCommand* command){
+    const FrameDurationCommand* later = dynamic_cast<const FrameDurationCommand*>(command);
+    if(later == nullptr || later->frame_ != frame_ || later->edit_ != edit_){
+        return false;
+    }
+    after_ = later->after_;
+    return true;
+}
+
+UndoStack::UndoStack(size_t memoryBudget) :
+    memoryBudget_(memoryBudget),
+    memoryUsed_(0){
+
+}
+
+/*
+ * adds a command that has already been applied to the top of the undo history. anything that could be redone is
+ * forgotten, since it no longer follows from the current state. a command that directly follows the newest one (with
+ * nothing undone in between) is merged into it when the two allow it, and if the merged command changes nothing (like
+ * stepping a duration up and back down) it is dropped.
+*/
+void UndoStack::push(UndoCommand* command){
+    bool follows = redo_.empty();
+    for(const unique_ptr<UndoCommand>& redoCommand : redo_){
+        removeMemory(*redoCommand);
+    }
+    redo_.clear();
+
+    if(follows && !undo_.empty()){
+        size_t costBefore = undo_.back()->memoryCost();
+        if(undo_.back()->mergeWith(command)){
+            memoryUsed_ = memoryUsed_ - costBefore + undo_.back()->memoryCost(); //merging never changes the frames a command holds
+            delete command;
+            if(undo_.back()->isObsolete()){
+                removeMemory(*undo_.back());
+                undo_.pop_back();
+            }
+            trim();
+            return;
+        }
+    }
+    addMemory(*command);
+    undo_.push_back(unique_ptr<UndoCommand>(command));
+    trim();
+}
+
+/*
+ * undoes the newest command and moves it onto the redo history
+*/
+void UndoStack::undo(ProjectState& project){
+    if(undo_.empty()){
+        return;
+    }
+    undo_.back()->undo(project);
+    redo_.push_back(move(undo_.back()));
+    undo_.pop_back();
+}
+
+/*
+ * redoes the most recently undone command and moves it back onto the undo history
+*/
+void UndoStack::redo(ProjectState& project){
+    if(redo_.empty()){
+        return;
+    }
+    redo_.back()->redo(project);
+    undo_.push_back(move(redo_.back()));
+    redo_.pop_back();
+}
+
+/*
+ * forgets every command
+*/
+void UndoStack::clear(){
+    undo_.clear();
+    redo_.clear();
+    versions_.clear();
+    memoryUsed_ = 0;
+}
+
+/*
+ * changes the number of bytes of history that are kept
+*/
+void UndoStack::setMemoryBudget(size_t bytes){
+    memoryBudget_ = bytes;
+    trim();
+}
+
+/*
+ * adds the cost of a command that joins the history, and the pixels of each frame version it holds that no other
+ * command holds yet. only the command's own frames are visited.
+*/
+void UndoStack::addMemory(const UndoCommand& command){
+    memoryUsed_ += command.memoryCost();
+    vector<const Frame*> frames;
+    command.collectFrames(frames);
+    for(const Frame* frame : frames){
+        Version& version = versions_[frame->version()];
+        version.references += 1;
+        if(version.references == 1){
+            version.bytes = frame->pixels().sizeInBytes();
+            memoryUsed_ += version.bytes;
+        }
+    }
+}
+
+/*
+ * takes away the cost of a command that leaves the history, and the pixels of each frame version that no other
+ * command holds any more
+*/
+void UndoStack::removeMemory(const UndoCommand& command){
+    memoryUsed_ -= command.memoryCost();
+    vector<const Frame*> frames;
+    command.collectFrames(frames);
+    for(const Frame* frame : frames){
+        map<const void*, Version>::iterator version = versions_.find(frame->version());
+        version->second.references -= 1;
+        if(version->second.references == 0){
+            memoryUsed_ -= version->second.bytes;
+            versions_.erase(version);
+        }
+    }
+}
+
+/*
+ * drops the oldest undo commands until the history fits in the budget. the newest command is always kept so the last
+ * operation can be undone even if it is bigger than the budget on its own.
+*/
+void UndoStack::trim(){
+    while(memoryUsed_ > memoryBudget_ && undo_.size() > 1){
+        removeMemory(*undo_.front());
+        undo_.pop_front();
+    }
+}
@@ -0,0 +1,160 @@
+/*
+ * undostack.h
+ * The UndoStack class keeps the undo and redo history of the whole sprite project. Instead of saving a copy of the
+ * whole frame for every mouse event, each entry is an UndoCommand describing one logical operation. A
+ * PixelEditCommand only stores the pixels one stroke, fill or shape changed (in any number of frames), and a
+ * ProjectCommand stores the frame list before and after a structural change (inserting, deleting or duplicating a
+ * frame, or resizing). Since frames are copy-on-write, those frame lists share the pixels of every frame that did not
+ * change, so a structural entry costs memory proportional to what actually changed. A FrameDurationCommand only stores
+ * the old and new duration of one frame, and the changes made by one use of the duration spin box are merged into
+ * one entry (or none, if the duration ends up where it started). Editing a frame later unshares it from the history, so the stack counts the pixels of every frame version
+ * the history holds (once, however many entries hold it) as its own, and drops its oldest entries once the history
+ * uses more memory than its budget. The count is kept up to date as entries come and go, visiting only their frames.
+ *
+ * Kira Parker
+ * Torin McDonald
+ * Melody Chang
+ * Christian Purdy
+ * Brayden Carlson
+ *
+ * A7: Sprite Editor Implementation (11/13/17)
+*/
+
+#ifndef UNDOSTACK_H
+#define UNDOSTACK_H
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include "frame.h"
+
+using namespace std;
+
+/*
+ * everything about the project that the history can change
+*/
+struct ProjectState{
+    vector<Frame> frames; //frames in the order they are played
+    unsigned int currentFrame = 0; //index of the frame being edited
+    int frameSize = 0; //number of rows (columns) of each frame that are in use
+};
+
+/*
+ * one operation that can be undone and redone
+*/
+class UndoCommand{
+public:
+    virtual ~UndoCommand(){}
+    virtual void undo(ProjectState& project) = 0; //puts the project back the way it was before the operation
+    virtual void redo(ProjectState& project) = 0; //applies the operation to the project again
+    virtual size_t memoryCost() const = 0; //number of bytes the command keeps alive, not counting the pixels of frames it holds
+    virtual void collectFrames(vector<const Frame*>& frames) const {(void)frames;} //adds the frames the command holds, whose pixels the stack counts
+    virtual bool mergeWith(const UndoCommand* command) {(void)command; return false;} //takes in a command applied right after this one, if both can be undone as one step
+    virtual bool isObsolete() const {return false;} //true if the command (after merging) changes nothing, so the stack can drop it
+};
+
+/*
+ * the pixels changed by one operation, in the order they were changed
+*/
+class PixelEditCommand : public UndoCommand{
+public:
+    PixelEditCommand(unsigned int currentFrame) : currentFrame_(currentFrame){}
+
+    void record(int frame, int row, int col, uint32_t before, uint32_t after); //adds one changed pixel (values are PixelBuffer words)
+    bool isEmpty() const {return changes_.empty();}
+
+    void undo(ProjectState& project) override;
+    void redo(ProjectState& project) override;
+    size_t memoryCost() const override;
+
+private:
+    struct PixelChange{
+        int frame; //index of the frame in the frames vector
+        int16_t row;
+        int16_t col;
+        uint32_t before; //pixel before the operation
+        uint32_t after; //pixel after the operation
+    };
+    unsigned int currentFrame_; //frame that was being edited, shown again when the command is undone or redone
+    vector<PixelChange> changes_;
+};
+
+/*
+ * a change to the list of frames or to the frame size
+*/
+class ProjectCommand : public UndoCommand{
+public:
+    ProjectCommand(const ProjectState& before, const ProjectState& after);
+
+    void undo(ProjectState& project) override;
+    void redo(ProjectState& project) override;
+    size_t memoryCost() const override;
+    void collectFrames(vector<const Frame*>& frames) const override;
+
+private:
+    ProjectState before_; //shares its pixels with after_ and with the live project wherever they are the same
+    ProjectState after_;
+};
+
+/*
+ * a change to how long one frame is shown
+*/
+class FrameDurationCommand : public UndoCommand{
+public:
+    FrameDurationCommand(unsigned int frame, int before, int after, int edit) :
+        frame_(frame), before_(before), after_(after), edit_(edit){}
+
+    void undo(ProjectState& project) override;
+    void redo(ProjectState& project) override;
+    size_t memoryCost() const override {return sizeof(*this);}
+    bool mergeWith(const UndoCommand* command) override;
+    bool isObsolete() const override {return before_ == after_;}
+
+private:
+    unsigned int frame_; //index of the frame in the frames vector
+    int before_; //duration before the change, in milliseconds
+    int after_; //duration after the change
+    int edit_; //which use of the duration spin box made the change (only changes from the same one are merged)
+};
+
+class UndoStack{
+public:
+    static const size_t DEFAULT_MEMORY_BUDGET = 16*1024*1024; //bytes of history kept by default
+
+    UndoStack(size_t memoryBudget = DEFAULT_MEMORY_BUDGET);
+
+    void push(UndoCommand* command); //takes ownership of a command that was just applied (merging it into the newest one if it can) and forgets the redo history
+    bool canUndo() const {return !undo_.empty();}
+    bool canRedo() const {return !redo_.empty();}
+    void undo(ProjectState& project); //undoes the most recent command
+    void redo(ProjectState& project); //redoes the most recently undone command
+    void clear(); //forgets the whole history
+
+    void setMemoryBudget(size_t bytes); //changes how many bytes of history are kept, dropping old commands if needed
+    size_t memoryBudget() const {return memoryBudget_;}
+    size_t memoryUsed() const {return memoryUsed_;}
+
+private:
+    deque<unique_ptr<UndoCommand>> undo_; //oldest command first
+    vector<unique_ptr<UndoCommand>> redo_; //most recently undone command last
+    size_t memoryBudget_;
+    /*
+     * a version of a frame's pixels held by the history
+    */
+    struct Version{
+        int references = 0; //number of frames in the commands of the history that share it
+        size_t bytes = 0; //size of its pixels
+    };
+
+    size_t memoryUsed_; //memory cost of every command in undo_ and redo_ plus the pixels of every version in versions_
+    map<const void*, Version> versions_; //frame versions the commands hold, by Frame::version
+
+    void addMemory(const UndoCommand& command); //counts a command that joins the history
+    void removeMemory(const UndoCommand& command); //stops counting a command that leaves the history
+    void trim(); //drops the oldest undo commands until the history fits in the budget
+};
+
+#endif // UNDOSTACK_H
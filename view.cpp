@@ -15,40 +15,48 @@
 #include "ui_view.h"
 #include "model.h"
 #include <math.h>
-#include <QQueue>
 #include <QColorDialog>
 #include <QFileDialog>
+#include <QInputDialog>
+#include <QSettings>
 #include <QMessageBox>
 #include <QDir>
-#include "gif.h"
+#include "gifexporter.h"
+#include "spritesheetexporter.h"
+#include "floodfill.h"
+#include "recolor.h"
+#include "rasterizer.h"
+#include <QtConcurrent>
+#include <QApplication>
+#include <QClipboard>
+#include <QMimeData>
 #include <QDebug>
 #include <QByteArray>
 #include <QImage>
 #include <QPixmap>
+#include <QSignalBlocker>
 
 
 View::View(Model& model, QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::View){
+    ui(new Ui::View),
+    model_(model),
+    fileOperation_(NoFileOperation),
+    gifExporter_(nullptr),
+    gifExportToClipboard_(false),
+    spriteSheetExporter_(nullptr),
+    pendingEdit_(nullptr),
+    frameDurationEdit_(0){
 
     ui->setupUi(this);
-    // set the default size of the edit frame table so the entry areas are square and the user cannot change the size of the table
-    ui->editFrameTable->horizontalHeader()->setDefaultSectionSize(ui->editFrameTable->width()/ui->editFrameTable->rowCount());
-    ui->editFrameTable->verticalHeader()->setDefaultSectionSize(ui->editFrameTable->height()/ui->editFrameTable->columnCount());
-    ui->editFrameTable->horizontalHeader()->sectionResizeMode(QHeaderView::Fixed);
-    ui->editFrameTable->verticalHeader()->sectionResizeMode(QHeaderView::Fixed);
 
     currentFrame_ = 101;
     currentFrameSize_ = 16;
-    populateWithWidgetItems(ui->editFrameTable);
+    ui->editCanvas->setCellCount(currentFrameSize_);
     createNewFrame();
 
-    //make the preview window table the correct size and make this size fixed
-    ui->previewWindowTable->horizontalHeader()->setDefaultSectionSize(ui->previewWindowTable->width()/ui->previewWindowTable->rowCount());
-    ui->previewWindowTable->verticalHeader()->setDefaultSectionSize(ui->previewWindowTable->height()/ui->previewWindowTable->columnCount());
-    ui->previewWindowTable->horizontalHeader()->sectionResizeMode(QHeaderView::Fixed);
-    ui->previewWindowTable->verticalHeader()->sectionResizeMode(QHeaderView::Fixed);
-    populateWithWidgetItems(ui->previewWindowTable);
+    //the preview window always shows the whole frame buffer, with the cells outside of the frame size greyed out
+    ui->previewCanvas->setCellCount(MAX_FRAME_SIZE);
 
     currentPlaybackSpeed_ = 100;
     currentPlaybackFrame_ = 0;
@@ -89,9 +97,19 @@ View::View(Model& model, QWidget *parent) :
     isDrawingShape_ = false;
 
     //signals for drawing on the frame
-    connect(ui->editFrameTable, SIGNAL(cellClicked(int,int)), this, SLOT(onCellClicked(int,int)));
-    connect(ui->editFrameTable, SIGNAL(cellEntered(int, int)), this, SLOT(onCellEntered(int,int)));
+    connect(ui->editCanvas, SIGNAL(cellClicked(int,int)), this, SLOT(onCellClicked(int,int)));
+    connect(ui->editCanvas, SIGNAL(cellEntered(int,int)), this, SLOT(onCellEntered(int,int)));
+    connect(ui->editCanvas, SIGNAL(strokeFinished()), this, SLOT(onStrokeFinished()));
+    connect(ui->editCanvas, SIGNAL(cellHovered(int,int)), this, SLOT(onCellHovered(int,int)));
+
+    //the samples of a stroke are drawn and saved together about once per screen refresh
+    lastStrokeCell_ = QPoint(-1, -1);
+    strokeCells_.resize(MAX_FRAME_SIZE, MAX_FRAME_SIZE);
+    strokeTimer_.setSingleShot(true);
+    strokeTimer_.setInterval(16);
+    connect(&strokeTimer_, SIGNAL(timeout()), this, SLOT(flushStroke()));
     connect(ui->alphaSlider, SIGNAL(sliderMoved(int)), this, SLOT(changeAlpha(int)));
+    connect(ui->fillScopeComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(changeFillScope(int)));
 
     //signals for moving between frames/creating frames/deleting frames
     connect(ui->frameSizeComboBox, SIGNAL(activated(int)), this, SLOT(changeNumberOfPixels(int)));
@@ -104,17 +122,41 @@ View::View(Model& model, QWidget *parent) :
 
     //signals for the playback window
     connect(ui->previewSlider, SIGNAL(sliderMoved(int)), this, SLOT(changePlaybackSpeed(int)));
+    connect(ui->frameDurationSpinBox, SIGNAL(valueChanged(int)), this, SLOT(changeFrameDuration(int)));
+    connect(ui->frameDurationSpinBox, SIGNAL(editingFinished()), this, SLOT(finishFrameDurationEdit()));
 
     //signals for save and load and Gif
     connect(ui->actionSave_Project, SIGNAL(triggered()), this, SLOT(saveProject()));
     connect(ui->actionLoad_Project, SIGNAL(triggered()), this, SLOT(loadProject()));
     connect(ui->actionExport_as_GIF, SIGNAL(triggered()), this, SLOT(on_gifButton_clicked()));
+    connect(ui->actionCopy_as_GIF, SIGNAL(triggered()), this, SLOT(copyGifToClipboard()));
+    connect(ui->actionExport_Sprite_Sheet, SIGNAL(triggered()), this, SLOT(exportSpriteSheet()));
+    connect(ui->actionUndo_History_Size, SIGNAL(triggered()), this, SLOT(changeUndoHistorySize()));
+
+    //the undo history keeps as much memory as the user last chose
+    int undoMegabytes = QSettings().value("undoHistoryMegabytes", int(UndoStack::DEFAULT_MEMORY_BUDGET/(1024*1024))).toInt();
+    undoStack_.setMemoryBudget(size_t(qBound(1, undoMegabytes, MAX_UNDO_MEGABYTES))*1024*1024);
 
     //connections for the model and the view
     connect(this, &View::saveProjectSignal, &model, &Model::saveProject);
     connect(&model, &Model::fileFailedToOpen, this, &View::fileFailedToOpen);
     connect(this, &View::loadProjectSignal, &model, &Model::loadProject);
     connect(&model, &Model::finishLoadingProject, this, &View::finishLoadingProject);
+    connect(&model, &Model::progressChanged, this, &View::showFileProgress);
+    connect(&model, &Model::operationFinished, this, &View::finishFileOperation);
+
+    //progress of loads and saves, shown in the status bar while the model works
+    fileProgressBar_ = new QProgressBar(this);
+    fileProgressBar_->setMaximumWidth(200);
+    fileProgressBar_->hide();
+    cancelFileButton_ = new QPushButton(tr("Cancel"), this);
+    cancelFileButton_->hide();
+    ui->statusBar->addPermanentWidget(fileProgressBar_);
+    ui->statusBar->addPermanentWidget(cancelFileButton_);
+    connect(cancelFileButton_, &QPushButton::clicked, this, &View::cancelFileOperation);
+    connect(&gifExportWatcher_, &QFutureWatcher<bool>::finished, this, &View::finishGifExport);
+    connect(&spriteSheetExportWatcher_, &QFutureWatcher<bool>::finished, this, &View::finishSpriteSheetExport);
+    gifExportPool_.setMaxThreadCount(1);
 }
 
 /*
@@ -136,8 +178,7 @@ void View::changeAlpha(int newAlpha){
  * called when a cell is clicked on, calls other various helper methods depending on which tool is currently selected
 */
 void View::onCellClicked(int x, int y){
-    saveFramesForUndo();
-    framesForRedo_.clear();
+    beginEdit();
     switch(currentTool_){
         case Draw:
             changeCellColor(x, y);
@@ -158,17 +199,29 @@ void View::onCellClicked(int x, int y){
 }
 
 /*
- * called when a cell is entered, calls other various helper methods depending on which tool is currently selected
+ * called when the mouse button is released over the edit canvas. the stroke (or fill, or shape) that started with the
+ * click is finished, so it becomes one entry in the undo history.
+*/
+void View::onStrokeFinished(){
+    strokeTimer_.stop();
+    drawStrokeSamples();
+    endEdit();
+    lastStrokeCell_ = QPoint(-1, -1);
+    strokeCells_.clear();
+}
+
+/*
+ * called when the mouse is dragged into a cell. for the draw and erase tools, the cell is added to the stroke; the
+ * samples are drawn and saved together on the next tick of the stroke timer instead of one at a time.
 */
 void View::onCellEntered(int x, int y){
-    saveFramesForUndo();
-    framesForRedo_.clear();
     switch(currentTool_){
         case Draw:
-            changeCellColor(x, y);
-            break;
         case Erase:
-            changeCellColor(x, y);
+            strokeSamples_.push_back(QPoint(y, x));
+            if(!strokeTimer_.isActive()){
+                strokeTimer_.start();
+            }
             break;
         default:
             break;
@@ -176,160 +229,231 @@ void View::onCellEntered(int x, int y){
 }
 
 /*
- * changes the color of the cell that was clicked on
+ * changes the color of the cell that was clicked on, which starts a stroke
 */
 void View::changeCellColor(int a, int b){
-    if(currentTool_ == 2){ // if eraser selected set color to white
-        ui->editFrameTable->item(a, b)->setBackground(QColor(255,255,255));
+    strokeCells_.clear();
+    lastStrokeCell_ = QPoint(b, a);
+    paintStroke({{a, b, b+1}});
+    saveCurrentFrame();
+}
+
+/*
+ * returns what the current tool paints with: the current color and blend mode, or opaque white for the eraser
+*/
+Compositor View::brush() const{
+    if(currentTool_ == Erase){
+        return Compositor(QColor(255,255,255));
     }
-    else{
-        ui->editFrameTable->item(a, b)->setBackground(currentColor_);
+    return Compositor(currentColor_, Compositor::BlendMode(ui->blendModeComboBox->currentIndex()));
+}
+
+/*
+ * paints the cells of the spans that the stroke in progress has not painted yet. a translucent stroke that crosses
+ * itself (or starts each line on the cell the last one ended on) would otherwise get darker where it overlaps.
+*/
+void View::paintStroke(const vector<PixelSpan>& spans){
+    vector<PixelSpan> fresh;
+    for(const PixelSpan& span : spans){
+        int start = -1; //first column of the run of fresh cells being collected
+        for(int col = span.left; col < span.right; col++){
+            if(strokeCells_.contains(span.row, col)){
+                if(start >= 0){
+                    fresh.push_back({span.row, start, col});
+                    start = -1;
+                }
+            }
+            else{
+                strokeCells_.mark(span.row, col);
+                if(start < 0){
+                    start = col;
+                }
+            }
+        }
+        if(start >= 0){
+            fresh.push_back({span.row, start, span.right});
+        }
     }
-    saveCurrentFrame();
+    ui->editCanvas->paintSpans(fresh, brush());
 }
 
 /*
- * performs breadth-first search to fill cells with color when using the fill tool
+ * draws the stroke through the cells the mouse was dragged over since the last tick onto the edit canvas. the mouse
+ * can skip cells when it moves quickly, so each sample is joined to the one before it with a line, and all of the
+ * lines are painted as one batch of spans.
+*/
+void View::drawStrokeSamples(){
+    if(strokeSamples_.empty()){
+        return;
+    }
+    Rasterizer rasterizer(currentFrameSize_);
+    for(const QPoint& sample : strokeSamples_){
+        QPoint from = (lastStrokeCell_.x() >= 0) ? lastStrokeCell_ : sample;
+        rasterizer.line(from.y(), from.x(), sample.y(), sample.x());
+        lastStrokeCell_ = sample;
+    }
+    strokeSamples_.clear();
+    paintStroke(rasterizer.spans());
+}
+
+/*
+ * called on each tick of the stroke timer while the mouse is dragged. draws the samples that came in since the last
+ * tick and saves them into the frames in one go.
+*/
+void View::flushStroke(){
+    drawStrokeSamples();
+    commitDirtyPixels();
+}
+
+/*
+ * fills the area around the clicked cell that has its color (or a color within the fill tolerance) with the current
+ * color. the area is found as spans of the edit canvas's pixels and painted onto the canvas in one go.
 */
 void View::fillCells(int x, int y){
+    if(ui->fillScopeComboBox->currentIndex() != 0 || !ui->fillContiguousCheckBox->isChecked()){
+        recolorFrames(x, y);
+        return;
+    }
     saveCurrentFrame();
 
-    vector<vector<QColor>> pixels = frames_[currentFrame_]->getPixels();
-    QColor startColor = pixels[x][y];
-
-    if (startColor != QColor(currentColor_)){
-        // Breadth-first search
-        QQueue<std::pair<int, int>> queue;
-        std::pair<int, int> start(x, y);
-        queue.enqueue(start);
-
-        while (!queue.isEmpty()){
-            std::pair<int, int> current = queue.dequeue();
-            // If current is the start color, change current to new color and enqueue all current's neighbors
-            if(current.first >= 0
-                    && current.second >= 0
-                    && current.first <= currentFrameSize_ - 1
-                    && current.second <= currentFrameSize_ -1
-                    && pixels[current.first][current.second] == startColor){
-                ui->editFrameTable->item(current.first, current.second)->setBackground(QColor(currentColor_));
-                pixels[current.first][current.second] = QColor(0,255,255);
-
-                queue.enqueue(std::pair<int, int>(current.first-1, current.second));
-                queue.enqueue(std::pair<int, int>(current.first+1, current.second));
-                queue.enqueue(std::pair<int, int>(current.first, current.second-1));
-                queue.enqueue(std::pair<int, int>(current.first, current.second+1));
-            }
-        }
+    const PixelBuffer& pixels = ui->editCanvas->pixels();
+    int tolerance = ui->fillToleranceSpinBox->value();
+    Compositor compositor = brush();
+    if(tolerance == 0 && compositor.composite(pixels.word(x, y)) == pixels.word(x, y)){
+        return; //every cell of the area has the clicked color, and painting over it changes nothing
     }
+
+    FloodFill fill(pixels, currentFrameSize_);
+    fill.setTolerance(tolerance);
+    fill.setDiagonal(ui->fillDiagonalCheckBox->isChecked());
+    ui->editCanvas->paintSpans(fill.fill(x, y), compositor);
     saveCurrentFrame();
 }
 
 /*
- * draws a rectangle with on corner where the user first clicked and the other corner where the user clicks the second time
+ * does the work of the fill tool on the frames chosen in the fill options, or replaces the clicked color everywhere in
+ * them when the fill is not contiguous. the frames are recolored in parallel and the change is one step in the undo
+ * history; frames that do not change keep sharing their pixels with the history.
 */
-void View::drawRect(int y, int x){
-    if(!isDrawingShape_){
-        isDrawingShape_ = true;
-        shapeCoords_.first = y;
-        shapeCoords_.second = x;
-        ui->editFrameTable->setCursor(rectOnCursor_);
+void View::recolorFrames(int row, int col){
+    endEdit(); //anything already drawn goes into the history before the recoloring
+
+    bool contiguous = ui->fillContiguousCheckBox->isChecked();
+    Recolor recolor(contiguous ? Recolor::Fill : Recolor::Replace, currentColor_, currentFrameSize_);
+    recolor.setFrom(frames_[currentFrame_].pixel(row, col));
+    recolor.setSeed(row, col);
+    recolor.setTolerance(ui->fillToleranceSpinBox->value());
+    recolor.setDiagonal(ui->fillDiagonalCheckBox->isChecked());
+    recolor.setBlendMode(Compositor::BlendMode(ui->blendModeComboBox->currentIndex()));
+
+    int first = currentFrame_;
+    int last = currentFrame_;
+    if(ui->fillScopeComboBox->currentIndex() == 1){
+        first = qMin(ui->fillFirstFrameSpinBox->value(), ui->fillLastFrameSpinBox->value())-1;
+        last = qMax(ui->fillFirstFrameSpinBox->value(), ui->fillLastFrameSpinBox->value())-1;
+    }
+    else if(ui->fillScopeComboBox->currentIndex() == 2){
+        first = 0;
+        last = frames_.size()-1;
     }
-    else{
-        int currentY = shapeCoords_.first;
-        int currentX = shapeCoords_.second;
-
-        ui->editFrameTable->item(currentY, shapeCoords_.second)->setBackground(currentColor_);
-        ui->editFrameTable->item(currentY, x)->setBackground(currentColor_);
 
-        while(y - currentY != 0){
-            if(y - currentY > 0){
-                currentY++;
-            }
-            else{
-                currentY--;
-            }
-            ui->editFrameTable->item(currentY, shapeCoords_.second)->setBackground(currentColor_);
-            ui->editFrameTable->item(currentY, x)->setBackground(currentColor_);
-        }
+    ProjectState before = projectState();
+    int changed = recolor.apply(frames_, first, last);
+    if(changed > 0){
+        recordProjectChange(before);
+        loadFrame(ui->editCanvas, currentFrame_);
+    }
+    ui->statusBar->showMessage(tr("Recolored %n frame(s)", "", changed), 3000);
+}
 
-        while(x - currentX != 0){
-            if(x - currentX > 0){
-                currentX++;
-            }
-            else{
-                currentX--;
-            }
-            ui->editFrameTable->item(shapeCoords_.first, currentX)->setBackground(currentColor_);
-            ui->editFrameTable->item(y, currentX)->setBackground(currentColor_);
-        }
+/*
+ * called when the user picks which frames the fill tool changes. the frame range can only be edited when it is used.
+*/
+void View::changeFillScope(int scope){
+    ui->fillFirstFrameSpinBox->setEnabled(scope == 1);
+    ui->fillLastFrameSpinBox->setEnabled(scope == 1);
+}
 
-        isDrawingShape_ = false;
-        ui->editFrameTable->setCursor(rectOffCursor_);
+/*
+ * draws a rectangle with one corner where the user first clicked and the other corner where the user clicks the second
+ * time. until the second click, the rectangle is previewed over the edit canvas.
+*/
+void View::drawRect(int y, int x){
+    if(!isDrawingShape_){
+        startShape(y, x);
+        ui->editCanvas->setCursor(rectOnCursor_);
+    }
+    else{
+        finishShape(y, x);
+        ui->editCanvas->setCursor(rectOffCursor_);
     }
 }
 
 /*
- * Draws a circle/ellipse when the circle drawing tool is selected. one side of the circle is at the user's first click,
- * and the opposite side is at the user's second click.
- * Uses Bresenham's circle/ellipse drawing algorithm
- * Implentation gotten from:
- * https://sites.google.com/site/ruslancray/lab/projects/bresenhamscircleellipsedrawingalgorithm/bresenham-s-circle-ellipse-drawing-algorithm
- */
+ * draws the ellipse that fits in the rectangle with one corner at the user's first click and the opposite corner at
+ * the user's second click. until the second click, the ellipse is previewed over the edit canvas.
+*/
 void View::drawCircle(int y, int x){
     if(!isDrawingShape_){
-        isDrawingShape_ = true;
-        shapeCoords_.first = y;
-        shapeCoords_.second = x;
-        ui->editFrameTable->setCursor(circleOnCursor_);
-    }
-
-    else if(abs(shapeCoords_.first-y)>1 || abs(shapeCoords_.second-x)>1){
-        int xc = (x + shapeCoords_.second) / 2;
-        int yc = (y + shapeCoords_.first) / 2;
-        int width = abs(x - shapeCoords_.second) / 2;
-        int height = abs(y - shapeCoords_.first) / 2;
-        int a2 = width * width;
-        int b2 = height * height;
-        int fa2 = 4 * a2, fb2 = 4 * b2;
-        int x, y, sigma;
-
-        for(x = 0, y = height, sigma = 2*b2+a2*(1-2*height); b2*x <= a2*y; x++){
-            ui->editFrameTable->item(yc + y, xc + x)->setBackground(currentColor_);
-            ui->editFrameTable->item(yc + y, xc - x)->setBackground(currentColor_);
-            ui->editFrameTable->item(yc - y, xc + x)->setBackground(currentColor_);
-            ui->editFrameTable->item(yc - y, xc - x)->setBackground(currentColor_);
-            if (sigma >= 0){
-                sigma += fa2 * (1 - y);
-                y--;
-            }
-            sigma += b2 * ((4 * x) + 6);
-        }
+        startShape(y, x);
+        ui->editCanvas->setCursor(circleOnCursor_);
+    }
+    else{
+        finishShape(y, x);
+        ui->editCanvas->setCursor(circleOffCursor_);
+    }
+}
 
-        for(x = width, y = 0, sigma = 2*a2+b2*(1-2*width); a2*y <= b2*x; y++){
-            ui->editFrameTable->item(yc + y, xc + x)->setBackground(currentColor_);
-            ui->editFrameTable->item(yc + y, xc - x)->setBackground(currentColor_);
-            ui->editFrameTable->item(yc - y, xc + x)->setBackground(currentColor_);
-            ui->editFrameTable->item(yc - y, xc - x)->setBackground(currentColor_);
-            if (sigma >= 0){
-                sigma += fb2 * (1 - x);
-                x--;
-            }
-            sigma += a2 * ((4 * y) + 6);
-        }
-        isDrawingShape_ = false;
-        ui->editFrameTable->setCursor(circleOffCursor_);
-        saveCurrentFrame();
+/*
+ * remembers the first corner of a shape and starts previewing it
+*/
+void View::startShape(int row, int col){
+    isDrawingShape_ = true;
+    shapeCoords_.first = row;
+    shapeCoords_.second = col;
+    previewShape(row, col);
+}
+
+/*
+ * adds the spans of the shape of the current tool, from the first corner to (row, col), to the rasterizer
+*/
+void View::rasterizeShape(Rasterizer& rasterizer, int row, int col) const{
+    bool filled = ui->filledShapesCheckBox->isChecked();
+    if(currentTool_ == Rectangle){
+        rasterizer.rectangle(shapeCoords_.first, shapeCoords_.second, row, col, filled);
+    }
+    else if(currentTool_ == Circle){
+        rasterizer.ellipse(shapeCoords_.first, shapeCoords_.second, row, col, filled);
     }
 }
 
 /*
- * populates the table widget with table widget items, which are what allow you to draw on the table
+ * shows the shape that a click on (row, col) would draw over the edit canvas, without changing the frame
 */
-void View::populateWithWidgetItems(QTableWidget* table){
-    for(int row = 0; row<table->rowCount(); row++){
-        for(int col = 0; col<table->columnCount(); col++){
-            table->setItem(row, col, new QTableWidgetItem());
-        }
+void View::previewShape(int row, int col){
+    Rasterizer rasterizer(currentFrameSize_);
+    rasterizeShape(rasterizer, row, col);
+    ui->editCanvas->setOverlay(rasterizer.spans(), currentColor_);
+}
+
+/*
+ * draws the shape from the first corner to (row, col) into the frame as spans, and saves it
+*/
+void View::finishShape(int row, int col){
+    Rasterizer rasterizer(currentFrameSize_);
+    rasterizeShape(rasterizer, row, col);
+    ui->editCanvas->clearOverlay();
+    ui->editCanvas->paintSpans(rasterizer.spans(), brush());
+    saveCurrentFrame();
+}
+
+/*
+ * called when the mouse moves over the edit canvas without a button held down. moves the preview of a shape whose
+ * second corner has not been clicked yet.
+*/
+void View::onCellHovered(int row, int col){
+    if(isDrawingShape_){
+        previewShape(row, col);
     }
 }
 
@@ -337,26 +461,15 @@ void View::populateWithWidgetItems(QTableWidget* table){
  * changes the number of pixels in the frame to the number specified in the combo box
 */
 void View::changeNumberOfPixels(int indexInComboBox){
-    int previousFrameSize = ui->editFrameTable->rowCount();
+    endEdit();
+    ProjectState before = projectState();
     currentFrameSize_ = atoi(ui->frameSizeComboBox->itemText(indexInComboBox).toStdString().c_str());
-    ui->editFrameTable->setRowCount(currentFrameSize_);
-    ui->editFrameTable->setColumnCount(currentFrameSize_);
-    ui->editFrameTable->horizontalHeader()->setDefaultSectionSize((ui->editFrameTable->width()+ui->editFrameTable->rowCount()-1)/ui->editFrameTable->rowCount());
-    ui->editFrameTable->verticalHeader()->setDefaultSectionSize((ui->editFrameTable->height()+ui->editFrameTable->columnCount()-1)/ui->editFrameTable->columnCount());
-    ui->editFrameTable->horizontalHeader()->sectionResizeMode(QHeaderView::Fixed);
-    ui->editFrameTable->verticalHeader()->sectionResizeMode(QHeaderView::Fixed);
-
-    //put widget items in these new cells
-    for(int row=0; row<ui->editFrameTable->rowCount(); row++){
-        for(int col = 0; col<ui->editFrameTable->columnCount(); col++){
-            if(row>=previousFrameSize || col >= previousFrameSize){
-                ui->editFrameTable->setItem(row,col,new QTableWidgetItem());
-            }
-        }
-    }
+    ui->editCanvas->setCellCount(currentFrameSize_);
+
     //these are here to fix the resize frame color bug. DO NOT CHANGE
-    loadFrame(ui->editFrameTable, currentFrame_);
+    loadFrame(ui->editCanvas, currentFrame_);
     saveCurrentFrame();
+    recordProjectChange(before);
 }
 
 /*
@@ -364,8 +477,12 @@ void View::changeNumberOfPixels(int indexInComboBox){
 */
 void View::createNewFrame(){
     //save current frame if there is one
-    if(currentFrame_ < 101){
+    bool firstFrame = (currentFrame_ == 101);
+    ProjectState before;
+    if(!firstFrame){
+        endEdit();
         saveCurrentFrame();
+        before = projectState();
     }
 
     if(currentFrame_ == 99){
@@ -374,25 +491,12 @@ void View::createNewFrame(){
         return;
     }
 
-    //create the new frame
-    vector<vector<QColor>> pixels;
-    for(int row = 0; row < MAX_FRAME_SIZE; row++){
-        vector<QColor> temp;
-        for(int col = 0; col < MAX_FRAME_SIZE; col++){
-            if(row < ui->editFrameTable->rowCount() && col < ui->editFrameTable->columnCount()){ //check if there is a cell there (depends on frame size)
-                ui->editFrameTable->item(row, col)->setBackground(QColor(255,255,255));
-                temp.push_back(ui->editFrameTable->item(row,col)->background().color());
-            }
-            else{
-                temp.push_back(QColor(255,255,255)); //cell not displayed because frame size is too small at the moment
-            }
-        }
-        pixels.push_back(temp);
-    }
-    Frame* frame = new Frame(pixels);
+    //create the new frame (cells not displayed because the frame size is too small at the moment are white too)
+    Frame frame(PixelBuffer(MAX_FRAME_SIZE, MAX_FRAME_SIZE, QColor(255,255,255), &FramePool::instance()));
+    ui->editCanvas->setPixels(frame.pixels());
 
     //insert the new frame after the current frame
-    vector<Frame*>::iterator it = frames_.begin();
+    vector<Frame>::iterator it = frames_.begin();
     if(currentFrame_ == 101){ //there is no frame yet
         frames_.push_back(frame);
         currentFrame_ = 0;
@@ -401,9 +505,10 @@ void View::createNewFrame(){
         frames_.insert(it+currentFrame_+1, frame);
         currentFrame_ += 1;
     }
-    framesForUndo_.clear();
-    framesForRedo_.clear();
     setFrameLabel();
+    if(!firstFrame){
+        recordProjectChange(before);
+    }
 }
 
 /*
@@ -418,7 +523,9 @@ void View::deleteFrame(){
     deleteFrameBox.exec();
 
     if(deleteFrameBox.clickedButton()==pButtonYes){
-        vector<Frame*>::iterator it = frames_.begin();
+        endEdit();
+        ProjectState before = projectState();
+        vector<Frame>::iterator it = frames_.begin();
         frames_.erase(it+currentFrame_);
         if(currentFrame_ == 0){
             if(frames_.size() == 0){
@@ -432,7 +539,7 @@ void View::deleteFrame(){
                 if(currentPlaybackFrame_ != 0){
                     currentPlaybackFrame_ -= 1;
                 }
-                loadFrame(ui->editFrameTable, currentFrame_);
+                loadFrame(ui->editCanvas, currentFrame_);
             }
         }
         else{
@@ -441,8 +548,9 @@ void View::deleteFrame(){
             }
             currentFrame_ = currentFrame_ -1;
             setFrameLabel();
-            loadFrame(ui->editFrameTable, currentFrame_);
+            loadFrame(ui->editCanvas, currentFrame_);
         }
+        recordProjectChange(before);
     }
 }
 
@@ -450,15 +558,11 @@ void View::deleteFrame(){
  * creates a new frame that is a duplicate of the previous frame
 */
 void View::duplicateFrame(){
-    vector<vector<QColor>> pixels = frames_[currentFrame_]->getPixels();
-    for(int row = 0; row<ui->editFrameTable->rowCount(); row++){
-        for(int col = 0; col<ui->editFrameTable->columnCount(); col++){
-            pixels[row][col]=ui->editFrameTable->item(row, col)->background().color();
-        }
-    }
-    Frame* frame = new Frame(pixels);
+    endEdit();
+    ProjectState before = projectState();
+    Frame frame = frames_[currentFrame_]; //shares the pixels until one of the two frames is edited
 
-    vector<Frame*>::iterator it = frames_.begin();
+    vector<Frame>::iterator it = frames_.begin();
     if(currentFrame_ == 101){ //there is no frame yet
         frames_.push_back(frame);
         currentFrame_ = 0;
@@ -467,9 +571,10 @@ void View::duplicateFrame(){
         frames_.insert(it+currentFrame_+1, frame);
         currentFrame_ += 1;
     }
-    loadFrame(ui->editFrameTable, currentFrame_);
+    loadFrame(ui->editCanvas, currentFrame_);
     setFrameLabel();
     saveCurrentFrame();
+    recordProjectChange(before);
 }
 
 /*
@@ -478,101 +583,139 @@ void View::duplicateFrame(){
 */
 void View::saveCurrentFrame(){
     isDrawingShape_ = false;
-    if(!(ui->editAllButton->isChecked())){ //if we only edit one frame
-        vector<vector<QColor>> pixels = frames_[currentFrame_]->getPixels();
-        for(int row = 0; row<ui->editFrameTable->rowCount(); row++){
-            for(int col = 0; col<ui->editFrameTable->columnCount(); col++){
-                pixels[row][col]=ui->editFrameTable->item(row, col)->background().color();
+    ui->editCanvas->clearOverlay();
+    drawStrokeSamples();
+    commitDirtyPixels();
+}
+
+/*
+ * copies the pixels that changed in the edit canvas since the last commit into the current frame (and into every
+ * other frame if we edit all frames). only the changed pixels are visited, so this is cheap for small edits.
+*/
+void View::commitDirtyPixels(){
+    const DirtyRegion& dirty = ui->editCanvas->dirtyRegion();
+    if(dirty.isEmpty()){
+        return;
+    }
+    bool standalone = (pendingEdit_ == nullptr); //changes made outside of a mouse operation get their own undo entry
+    beginEdit();
+    const PixelBuffer& canvasPixels = ui->editCanvas->pixels();
+    for(unsigned int i=0; i<frames_.size(); i++){
+        if(i == currentFrame_ || ui->editAllButton->isChecked()){
+            PixelBuffer& pixels = frames_[i].editPixels();
+            for(int index : dirty.pixels()){
+                int row = index / dirty.width();
+                int col = index % dirty.width();
+                uint32_t after = canvasPixels.word(row, col);
+                pendingEdit_->record(i, row, col, pixels.word(row, col), after);
+                pixels.setWord(row, col, after);
             }
         }
-        frames_[currentFrame_]->saveFrame(pixels);
-    }
-    else{//if we edit all frames
-        vector<vector<QColor>> pixels = frames_[currentFrame_]->getPixels();
-        vector<vector<bool>> pixelsChanged;
-        for(int row = 0; row<ui->editFrameTable->rowCount(); row++){
-            vector<bool> tempPixelsChanged;
-            for(int col = 0; col<ui->editFrameTable->columnCount(); col++){
-                if(pixels[row][col] != ui->editFrameTable->item(row,col)->background().color()){ //this pixel was updated
-                    tempPixelsChanged.push_back(true);
-                }
-                else{
-                    tempPixelsChanged.push_back(false);
-                }
-                pixels[row][col]=ui->editFrameTable->item(row, col)->background().color();
-            }
-            pixelsChanged.push_back(tempPixelsChanged);
+    }
+    ui->editCanvas->clearDirty();
+    if(standalone){
+        endEdit();
+    }
+}
+
+/*
+ * starts recording the pixel changes of one logical operation (one stroke, fill or shape) for the undo history
+*/
+void View::beginEdit(){
+    if(pendingEdit_ == nullptr){
+        pendingEdit_ = new PixelEditCommand(currentFrame_);
+    }
+}
+
+/*
+ * saves any remaining changes of the current operation and pushes the operation onto the undo history
+*/
+void View::endEdit(){
+    commitDirtyPixels();
+    if(pendingEdit_ != nullptr){
+        if(pendingEdit_->isEmpty()){
+            delete pendingEdit_;
         }
-        frames_[currentFrame_]->saveFrame(pixels); //save for current frame
-        //save update for each other frame
-        vector<vector<QColor>> otherPixels;
-        for(unsigned int i=0; i<frames_.size(); i++){
-            if(i != currentFrame_){
-                otherPixels = frames_[i]->getPixels();
-                for(unsigned int row = 0; row<pixelsChanged.size(); row++){
-                    for(unsigned int col=0; col<pixelsChanged[0].size(); col++){
-                        if(pixelsChanged[row][col]){
-                            otherPixels[row][col] = pixels[row][col];
-                        }
-                    }
-                }
-                frames_[i]->saveFrame(otherPixels);
-            }
+        else{
+            undoStack_.push(pendingEdit_);
         }
+        pendingEdit_ = nullptr;
     }
 }
 
 /*
- * saves the current frame changes into the FramesForUndo
+ * returns a snapshot of the project for the undo history. the frames share their pixels with frames_, so this only
+ * copies one handle per frame.
 */
-void View::saveFramesForUndo(){
-    vector<vector<QColor>> pixels = frames_[currentFrame_]->getPixels();
-    for(int row = 0; row<ui->editFrameTable->rowCount(); row++){
-        for(int col = 0; col<ui->editFrameTable->columnCount(); col++){
-            pixels[row][col]=ui->editFrameTable->item(row, col)->background().color();
-        }
+ProjectState View::projectState() const{
+    ProjectState state;
+    state.frames = frames_;
+    state.currentFrame = currentFrame_;
+    state.frameSize = currentFrameSize_;
+    return state;
+}
+
+/*
+ * adds a structural change (from before to the current project) to the undo history, unless nothing changed
+*/
+void View::recordProjectChange(const ProjectState& before){
+    bool changed = before.frames.size() != frames_.size()
+            || before.currentFrame != currentFrame_
+            || before.frameSize != currentFrameSize_;
+    for(unsigned int i=0; !changed && i<frames_.size(); i++){
+        changed = before.frames[i].version() != frames_[i].version()
+                || before.frames[i].duration() != frames_[i].duration();
+    }
+    if(changed){
+        undoStack_.push(new ProjectCommand(before, projectState()));
     }
-    Frame* frame = new Frame(pixels);
-    framesForUndo_.push_back(frame);
 }
 
 /*
- * display the undo frame by changing the current frame to the last frame from the framesForUndo
+ * undoes or redoes one step of the history. the frames are moved out of the view while the command runs so that
+ * editing them in place does not make copies of their pixels.
 */
-void View::displayUndoFrame(){
-    if(framesForUndo_.size()>0){
-        saveFramesForRedo();
-        vector<vector<QColor>> pixels = framesForUndo_[framesForUndo_.size()-1]->getPixels();
-        frames_[currentFrame_]->saveFrame(pixels);
-        loadFrame(ui->editFrameTable, currentFrame_);
-        framesForUndo_.pop_back();
+void View::applyHistory(bool undo){
+    ProjectState project;
+    project.frames = move(frames_);
+    project.currentFrame = currentFrame_;
+    project.frameSize = currentFrameSize_;
+    if(undo){
+        undoStack_.undo(project);
     }
+    else{
+        undoStack_.redo(project);
+    }
+
+    frames_ = move(project.frames);
+    currentFrame_ = project.currentFrame;
+    if(project.frameSize != currentFrameSize_){
+        showFrameSize(project.frameSize);
+    }
+    if(currentPlaybackFrame_ >= frames_.size()){
+        currentPlaybackFrame_ = 0;
+    }
+    loadFrame(ui->editCanvas, currentFrame_);
+    setFrameLabel();
 }
 
 /*
- * saves the current frame changes into the FramesForRedo
+ * undoes the last operation (a drawing operation or a change to the frames) and shows the result
 */
-void View::saveFramesForRedo(){
-    vector<vector<QColor>> pixels = frames_[currentFrame_]->getPixels();
-    for(int row = 0; row<ui->editFrameTable->rowCount(); row++){
-        for(int col = 0; col<ui->editFrameTable->columnCount(); col++){
-            pixels[row][col]=ui->editFrameTable->item(row, col)->background().color();
-        }
+void View::displayUndoFrame(){
+    endEdit();
+    if(undoStack_.canUndo()){
+        applyHistory(true);
     }
-    Frame* frame = new Frame(pixels);
-    framesForRedo_.push_back(frame);
 }
 
 /*
- * display the redo frame by changing the current frame to the last frame from the framesForRedo
+ * redoes the last undone operation and shows the result
 */
 void View::displayRedoFrame(){
-    if(framesForRedo_.size()>0){
-        saveFramesForUndo();
-        vector<vector<QColor>> pixels = framesForRedo_[framesForRedo_.size()-1]->getPixels();
-        frames_[currentFrame_]->saveFrame(pixels);
-        loadFrame(ui->editFrameTable, currentFrame_);
-        framesForRedo_.pop_back();
+    endEdit();
+    if(undoStack_.canRedo()){
+        applyHistory(false);
     }
 }
 
@@ -581,7 +724,6 @@ void View::displayRedoFrame(){
 */
 void View::goToNextFrame(){
     saveCurrentFrame();
-    framesForUndo_.clear();
 
     if(currentFrame_ == frames_.size()-1){
         currentFrame_ = 0;
@@ -590,7 +732,7 @@ void View::goToNextFrame(){
 
         currentFrame_ += 1;
     }
-    loadFrame(ui->editFrameTable, currentFrame_);
+    loadFrame(ui->editCanvas, currentFrame_);
     setFrameLabel();
 }
 
@@ -599,7 +741,6 @@ void View::goToNextFrame(){
 */
 void View::goToPreviousFrame(){
     saveCurrentFrame();
-    framesForUndo_.clear();
 
     if(currentFrame_ == 0){
         currentFrame_ = frames_.size()-1;
@@ -608,68 +749,75 @@ void View::goToPreviousFrame(){
 
         currentFrame_ -= 1;
     }
-    loadFrame(ui->editFrameTable, currentFrame_);
+    loadFrame(ui->editCanvas, currentFrame_);
     setFrameLabel();
 }
 
 /*
- * load the frame at the index currentFrame_ in frames_ into the table
+ * load the frame at the index currentFrame_ in frames_ into the canvas
 */
-void View::loadFrame(QTableWidget* table, int frameIndex){
-    vector<vector<QColor>> pixels = frames_[frameIndex]->getPixels();
-    for(int row = 0; row<currentFrameSize_; row++){
-        for(int col = 0; col<currentFrameSize_; col++){
-            table->item(row, col)->setBackground(pixels[row][col]);
-        }
-    }
+void View::loadFrame(PixelCanvas* canvas, int frameIndex){
+    canvas->setPixels(frames_[frameIndex].pixels());
 }
 
 /*
- * load the frame at the index currentFrame_ in frames_ into the table
+ * load the full frame at the index frameIndex in frames_ into the preview canvas. the cells outside of the current
+ * frame size are shown in grey.
 */
-void View::loadPreviewFrame(QTableWidget* table, int frameIndex){
-    vector<vector<QColor>> pixels = frames_[frameIndex]->getPixels();
-    for(int row = 0; row<currentFrameSize_; row++){
-        for(int col = 0; col<currentFrameSize_; col++){
-            table->item(row, col)->setBackground(pixels[row][col]);
-        }
-        for(int col = currentFrameSize_; col<MAX_FRAME_SIZE; col++){
-            QColor item= pixels[row][col];
-            QColor newColor; //create new qcolor from rgba
-            newColor.setRgb( 192,192,192,  item.alpha());
-            table->item(row, col)->setBackground(newColor);
+void View::loadPreviewFrame(PixelCanvas* canvas, int frameIndex){
+    PixelBuffer pixels = frames_[frameIndex].pixels();
+    for(int row = 0; row<MAX_FRAME_SIZE; row++){
+        uint8_t* line = pixels.scanLine(row);
+        for(int col = (row < currentFrameSize_ ? currentFrameSize_ : 0); col<MAX_FRAME_SIZE; col++){
+            uint8_t* p = line + col*PixelBuffer::BYTES_PER_PIXEL;
+            p[0] = p[1] = p[2] = 192; //keep the alpha of the pixel
         }
     }
-    for(int row = currentFrameSize_; row<MAX_FRAME_SIZE; row++){
-        for(int col = 0; col<MAX_FRAME_SIZE; col++){
-            QColor item= pixels[row][col];
-            QColor newColor; //create new qcolor from rgba
-            newColor.setRgb( 192,192,192,   item.alpha());
-            table->item(row, col)->setBackground(newColor);
-        }
-    }
-
+    canvas->setPixels(move(pixels));
 }
 
 /*
- * updates the frame label in the view (says "Frame ___ out of ___" )
+ * updates the frame label in the view (says "Frame ___ out of ___" ), the duration of the frame and the frames the
+ * fill range can cover
 */
 void View::setFrameLabel(){
     ui->frameLabel->setText("Frame " + QString::number(currentFrame_+1) + " out of " + QString::number(frames_.size()));
+    ui->fillFirstFrameSpinBox->setMaximum(frames_.size());
+    ui->fillLastFrameSpinBox->setMaximum(frames_.size());
+
+    //showing the duration of another frame is not a change to the duration
+    QSignalBlocker blocker(ui->frameDurationSpinBox);
+    ui->frameDurationSpinBox->setValue(frames_[currentFrame_].duration());
+}
+
+/*
+ * changes the size of the frames to frameSize (rows and columns) and shows it in the combo box and the edit canvas.
+ * sizes that are not in the combo box (from a project made elsewhere) are added to it.
+*/
+void View::showFrameSize(int frameSize){
+    currentFrameSize_ = frameSize;
+    int index = ui->frameSizeComboBox->findText(QString::number(frameSize));
+    if(index < 0){
+        ui->frameSizeComboBox->addItem(QString::number(frameSize));
+        index = ui->frameSizeComboBox->count()-1;
+    }
+    ui->frameSizeComboBox->setCurrentIndex(index);
+    ui->editCanvas->setCellCount(frameSize);
 }
 
 /*
  * updates the frame displayed in the preview window
 */
 void View::updatePreview(){
-    loadPreviewFrame(ui->previewWindowTable, currentPlaybackFrame_);
+    loadPreviewFrame(ui->previewCanvas, currentPlaybackFrame_);
+    int duration = frames_[currentPlaybackFrame_].duration();
     if(currentPlaybackFrame_ == frames_.size()-1){
         currentPlaybackFrame_ = 0;
     }
     else{
         currentPlaybackFrame_ += 1;
     }
-    playbackTimer_.singleShot(currentPlaybackSpeed_, this, &View::updatePreview);
+    playbackTimer_.singleShot(duration > 0 ? duration : currentPlaybackSpeed_, this, &View::updatePreview);
 }
 
 /*
@@ -679,13 +827,35 @@ void View::changePlaybackSpeed(int newFPS){
     currentPlaybackSpeed_ = 1000/newFPS;
 }
 
+/*
+ * sets how long the current frame is shown in the preview and in exported gifs (0 for the playback speed). every step
+ * of the spin box is merged into the undo entry of the step before it until the user leaves the spin box, so
+ * scrolling the duration is undone at once.
+*/
+void View::changeFrameDuration(int duration){
+    endEdit();
+    int before = frames_[currentFrame_].duration();
+    if(before == duration){
+        return;
+    }
+    frames_[currentFrame_].setDuration(duration);
+    undoStack_.push(new FrameDurationCommand(currentFrame_, before, duration, frameDurationEdit_));
+}
+
+/*
+ * called when the user presses enter in the frame duration spin box or leaves it
+*/
+void View::finishFrameDurationEdit(){
+    frameDurationEdit_ += 1;
+}
+
 /*
  * called when the user clicks on the draw tool (pencil). sets the current tool to Draw and assigns the appropriate cursor.
 */
 void View::on_drawToolButton_clicked(){
     currentTool_ = Draw;
     checkButton(Draw);
-    ui->editFrameTable->setCursor(drawCursor_);
+    ui->editCanvas->setCursor(drawCursor_);
 }
 
 /*
@@ -694,7 +864,7 @@ void View::on_drawToolButton_clicked(){
 void View::on_fillToolButton_clicked(){
     currentTool_ = Fill;
     checkButton(Fill);
-    ui->editFrameTable->setCursor(fillCursor_);
+    ui->editCanvas->setCursor(fillCursor_);
 }
 
 /*
@@ -703,7 +873,7 @@ void View::on_fillToolButton_clicked(){
 void View::on_eraseToolButton_clicked(){
     currentTool_ = Erase;
     checkButton(Erase);
-    ui->editFrameTable->setCursor(eraseCursor_);
+    ui->editCanvas->setCursor(eraseCursor_);
 }
 
 /*
@@ -713,8 +883,9 @@ void View::on_eraseToolButton_clicked(){
 void View::on_rectToolButton_clicked(){
     currentTool_ = Rectangle;
     checkButton(Rectangle);
-    ui->editFrameTable->setCursor(rectOffCursor_);
+    ui->editCanvas->setCursor(rectOffCursor_);
     isDrawingShape_ = false;
+    ui->editCanvas->clearOverlay();
 }
 
 /*
@@ -724,8 +895,9 @@ void View::on_rectToolButton_clicked(){
 void View::on_circleToolButton_clicked(){
     currentTool_ = Circle;
     checkButton(Circle);
-    ui->editFrameTable->setCursor(circleOffCursor_);
+    ui->editCanvas->setCursor(circleOffCursor_);
     isDrawingShape_ = false;
+    ui->editCanvas->clearOverlay();
 }
 
 /*
@@ -758,14 +930,20 @@ void View::checkButton(Tool t){
 }
 
 /*
- * called when the user wishes to save a project. saves the project to a .ssp file with the specifications
- * listed in the assignment.
+ * called when the user wishes to save a project. the model saves it to a .ssp file on its own thread while the user
+ * keeps editing.
 */
 void View::saveProject(){
     QString fileName = QFileDialog::getSaveFileName(this,
         tr("Save Sprite"), "",
         tr("Sprite (*.ssp);;All Files (*)"));
-    emit saveProjectSignal(frames_, currentFrameSize_, fileName);
+    if(fileName.isEmpty()){
+        return;
+    }
+    commitDirtyPixels();
+    beginFileOperation(ProjectFileOperation, tr("Saving project..."));
+    model_.resetCancel();
+    emit saveProjectSignal(frames_, currentFrameSize_, fileName); //the frames are shared, so later edits do not change what is saved
 }
 
 /*
@@ -773,61 +951,209 @@ void View::saveProject(){
  * displays the new project in place of the user's current project.
 */
 void View::loadProject(){
-    currentFrame_ =0; //index of the current frame in frames_
-    currentPlaybackFrame_=0; //the index of the frame being played back in frames_
-
     QString fileName = QFileDialog::getOpenFileName(this,
            tr("Open Sprite"), "",
            tr("Sprite (*.ssp);;All Files (*)"));
+    if(fileName.isEmpty()){
+        return;
+    }
+    beginFileOperation(ProjectFileOperation, tr("Loading project..."));
+    model_.resetCancel();
     emit loadProjectSignal(fileName);
 }
 
 /*
  * called after the model loads the frame, sets all of the appropriate variables in the view
 */
-void View::finishLoadingProject(vector<Frame*> newFrames){
-    frames_=newFrames;
-    currentFrame_=0;
+void View::finishLoadingProject(vector<Frame> newFrames, int frameSize){
+    endEdit();
+    frames_=move(newFrames);
+    currentFrame_=0; //index of the current frame in frames_
+    currentPlaybackFrame_=0; //the index of the frame being played back in frames_
+    showFrameSize(frameSize);
+    undoStack_.clear();
     setFrameLabel();
-    loadFrame(ui->editFrameTable, currentFrame_);
+    loadFrame(ui->editCanvas, currentFrame_);
 }
 
 /*
- * called when the user creates a gif. uses the gif.h header file to create a gif.
+ * shows the progress bar and cancel button for a load, save or export, and turns off saving, loading and exporting
+ * until it is done.
+ * editing and the preview keep running while the model works.
+*/
+void View::beginFileOperation(FileOperation operation, const QString& message){
+    fileOperation_ = operation;
+    ui->actionSave_Project->setEnabled(false);
+    ui->actionLoad_Project->setEnabled(false);
+    ui->actionExport_as_GIF->setEnabled(false);
+    ui->actionCopy_as_GIF->setEnabled(false);
+    ui->actionExport_Sprite_Sheet->setEnabled(false);
+    ui->statusBar->showMessage(message);
+    fileProgressBar_->setRange(0, 0); //busy indicator until the first progress report
+    fileProgressBar_->show();
+    cancelFileButton_->show();
+}
+
+/*
+ * updates the progress bar with the number of frames the model has loaded or saved
+*/
+void View::showFileProgress(int completed, int total){
+    fileProgressBar_->setRange(0, total);
+    fileProgressBar_->setValue(completed);
+}
+
+/*
+ * hides the progress of a load, save or export that ended and lets the user save, load and export again
+*/
+void View::finishFileOperation(){
+    fileOperation_ = NoFileOperation;
+    fileProgressBar_->hide();
+    cancelFileButton_->hide();
+    ui->statusBar->clearMessage();
+    ui->actionSave_Project->setEnabled(true);
+    ui->actionLoad_Project->setEnabled(true);
+    ui->actionExport_as_GIF->setEnabled(true);
+    ui->actionCopy_as_GIF->setEnabled(true);
+    ui->actionExport_Sprite_Sheet->setEnabled(true);
+}
+
+/*
+ * stops the load, save or export in progress. the model's thread and the export job are busy, so this sets the cancel
+ * flag of the one that is running directly instead of sending it a signal.
+*/
+void View::cancelFileOperation(){
+    switch(fileOperation_){
+        case ProjectFileOperation:
+            model_.cancel();
+            break;
+        case GifExportOperation:
+            gifExporter_->cancel();
+            break;
+        case SpriteSheetExportOperation:
+            spriteSheetExporter_->cancel();
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * called when the user creates a gif. the gif is written to the file the user picks.
 */
 void View::on_gifButton_clicked(){
-    GifWriter writer;
-    int gifSize = currentFrameSize_ * currentFrameSize_*4;
+    if(fileOperation_ != NoFileOperation){
+        return;
+    }
     QString fileName = QFileDialog::getSaveFileName(this,
         tr("Create GIF"), "",
         tr("Sprite (*.gif);;All Files (*)"));
-    GifBegin(&writer, fileName.toLocal8Bit().constData(), currentFrameSize_, currentFrameSize_, true);
-    //for each frame, convert to QImage
-    for(Frame* a : frames_){
-
-        vector<vector<QColor>> pixels = a->getPixels();
-        uint8_t *gifImage = new uint8_t[gifSize];
-        //fill all pixels of image with default white
-        for(int row = 0; row < currentFrameSize_; row++){
-            for(int col = 0; col < currentFrameSize_; col++){
-                int colorIndex = 0;
-        //single index pixel from 2d vector into gifImage,
-        //seperate each (RGBA) color and put in its 4 bit index
-                QColor color = pixels[row][col];
-                gifImage[(row * currentFrameSize_ + col) * 4] = color.red();
-                colorIndex++;
-                gifImage[(row * currentFrameSize_ + col) * 4 + colorIndex] = color.green();
-                colorIndex++;
-                gifImage[(row * currentFrameSize_ + col) * 4 + colorIndex] = color.blue();
-                colorIndex++;
-                gifImage[(row * currentFrameSize_ + col) * 4 + colorIndex] = color.alpha();
+    if(fileName.isEmpty()){
+        return;
+    }
+    startGifExport(fileName);
+}
 
-            }
-        }
+/*
+ * called when the user copies the animation as a gif. the gif is made in memory and put on the clipboard.
+*/
+void View::copyGifToClipboard(){
+    if(fileOperation_ != NoFileOperation){
+        return;
+    }
+    startGifExport(QString());
+}
+
+/*
+ * called when the user exports a sprite sheet. the frames are packed into a png atlas (with a json file next to it
+ * that says where each frame is). like a gif export, this runs in the background over a snapshot of the frames, shows
+ * its progress and can be canceled.
+*/
+void View::exportSpriteSheet(){
+    if(fileOperation_ != NoFileOperation){
+        return;
+    }
+    QString fileName = QFileDialog::getSaveFileName(this,
+        tr("Export Sprite Sheet"), "",
+        tr("Sprite Sheet (*.png);;All Files (*)"));
+    if(fileName.isEmpty()){
+        return;
+    }
+    commitDirtyPixels();
+
+    spriteSheetExporter_ = new SpriteSheetExporter(frames_, currentFrameSize_, currentPlaybackSpeed_);
+    connect(spriteSheetExporter_, &SpriteSheetExporter::progressChanged, this, &View::showFileProgress);
+    beginFileOperation(SpriteSheetExportOperation, tr("Exporting sprite sheet..."));
+    spriteSheetExportWatcher_.setFuture(QtConcurrent::run(spriteSheetExporter_, &SpriteSheetExporter::exportToFile, fileName));
+}
+
+/*
+ * called when the background sprite sheet export is done. shows why it failed (a canceled export has no error).
+*/
+void View::finishSpriteSheetExport(){
+    bool exported = spriteSheetExportWatcher_.result();
+    QString error = spriteSheetExporter_->errorString();
+    delete spriteSheetExporter_;
+    spriteSheetExporter_ = nullptr;
+    finishFileOperation();
+    if(!exported && !error.isEmpty()){
+        QMessageBox::information(this, tr("Unable to export sprite sheet"), error);
+    }
+}
+
+/*
+ * called when the user changes the size of the undo history. the oldest steps are dropped right away if the history no
+ * longer fits, and the size is saved for the next time the editor starts.
+*/
+void View::changeUndoHistorySize(){
+    bool ok;
+    int megabytes = QInputDialog::getInt(this, tr("Undo History Size"), tr("Memory kept for undo (MB):"),
+                                         int(undoStack_.memoryBudget()/(1024*1024)), 1, MAX_UNDO_MEGABYTES, 1, &ok);
+    if(!ok){
+        return;
+    }
+    undoStack_.setMemoryBudget(size_t(megabytes)*1024*1024);
+    QSettings().setValue("undoHistoryMegabytes", megabytes);
+}
 
-        GifWriteFrame(&writer,gifImage, currentFrameSize_, currentFrameSize_, true);
+/*
+ * starts exporting the frames as a gif to fileName, or to the clipboard if fileName is empty. the export runs in the
+ * background over a snapshot of the frames (the frames are shared, so this copies no pixels), and the user can keep
+ * editing while it runs.
+*/
+void View::startGifExport(const QString& fileName){
+    commitDirtyPixels();
+
+    gifExporter_ = new GifExporter(frames_, currentFrameSize_, currentPlaybackSpeed_);
+    connect(gifExporter_, &GifExporter::progressChanged, this, &View::showFileProgress);
+    gifExportToClipboard_ = fileName.isEmpty();
+    if(gifExportToClipboard_){
+        beginFileOperation(GifExportOperation, tr("Copying GIF..."));
+        gifExportWatcher_.setFuture(QtConcurrent::run(&gifExportPool_, gifExporter_, &GifExporter::exportToBuffer));
+    }
+    else{
+        beginFileOperation(GifExportOperation, tr("Exporting GIF..."));
+        gifExportWatcher_.setFuture(QtConcurrent::run(&gifExportPool_, gifExporter_, &GifExporter::exportToFile, fileName));
+    }
+}
+
+/*
+ * called when the background export is done. puts a gif made for the clipboard on it, or shows why the export failed
+ * (a canceled export has no error).
+*/
+void View::finishGifExport(){
+    bool exported = gifExportWatcher_.result();
+    QString error = gifExporter_->errorString();
+    if(exported && gifExportToClipboard_){
+        QMimeData* mimeData = new QMimeData();
+        mimeData->setData("image/gif", gifExporter_->data());
+        QApplication::clipboard()->setMimeData(mimeData);
+    }
+    delete gifExporter_;
+    gifExporter_ = nullptr;
+    finishFileOperation();
+    if(!exported && !error.isEmpty()){
+        QMessageBox::information(this, tr("Unable to export GIF"), error);
     }
-    GifEnd(&writer);
 }
 
 
@@ -861,11 +1187,19 @@ void View::on_currentColorTab_pressed(){
 }
 
 /*
- * disposes of each frame in the frames vector (not sure if this is necessary)
+ * disposes of the operation being recorded and the ui (the frames free themselves)
 */
 View::~View(){
-    for(unsigned int i=0; i<frames_.size(); i++){
-        delete frames_[i];
+    if(gifExporter_ != nullptr){
+        gifExporter_->cancel();
+        gifExportWatcher_.waitForFinished();
+        delete gifExporter_;
+    }
+    if(spriteSheetExporter_ != nullptr){
+        spriteSheetExporter_->cancel();
+        spriteSheetExportWatcher_.waitForFinished();
+        delete spriteSheetExporter_;
     }
+    delete pendingEdit_;
     delete ui;
 }
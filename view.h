@@ -18,16 +18,27 @@
 #define VIEW_H
 
 #include <QMainWindow>
-#include <QTableWidgetItem>
 #include <QTimer>
+#include <QPoint>
 #include <QColor>
 #include <QPair>
 #include <vector>
 #include<QStandardPaths>
 #include <QMessageBox>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QFutureWatcher>
+#include <QThreadPool>
 
 #include "frame.h"
 #include "model.h"
+#include "pixelcanvas.h"
+#include "undostack.h"
+#include "gifexporter.h"
+#include "spritesheetexporter.h"
+#include "rasterizer.h"
+#include "compositor.h"
+#include "dirtyregion.h"
 
 
 using namespace std;
@@ -48,17 +59,36 @@ private:
         Draw, Fill, Erase, Rectangle, Circle
     };
 
+    enum FileOperation{
+        NoFileOperation, ProjectFileOperation, GifExportOperation, SpriteSheetExportOperation //nothing, a load or save by the model, a background GIF or sprite sheet export
+    };
+
     Ui::View *ui;
-    vector<Frame*> frames_; //list of the frames in the order that they will be played in the animation window
-    vector<Frame*> framesForUndo_; // list of the frames in order for the undo
-    vector<Frame*> framesForRedo_; // list of the frames in order for the Redo
+    Model& model_; //loads and saves projects on its own thread
+    QProgressBar* fileProgressBar_; //shows how much of a project has been loaded or saved
+    QPushButton* cancelFileButton_; //stops the load, save or export in progress
+    FileOperation fileOperation_; //the load, save or export in progress, which is the one the cancel button stops
+    GifExporter* gifExporter_; //GIF export running in the background, or nullptr if there is none
+    bool gifExportToClipboard_; //true if the background export is for the clipboard rather than a file
+    QFutureWatcher<bool> gifExportWatcher_; //tells the view when the background export is done
+    QThreadPool gifExportPool_; //runs the export job, which waits on the frame encoders in the global pool
+    SpriteSheetExporter* spriteSheetExporter_; //sprite sheet export running in the background, or nullptr if there is none
+    QFutureWatcher<bool> spriteSheetExportWatcher_; //tells the view when the background sprite sheet export is done
+    vector<Frame> frames_; //list of the frames in the order that they will be played in the animation window
+    UndoStack undoStack_; //history of operations for undo and redo
+    PixelEditCommand* pendingEdit_; //pixel changes of the operation in progress, or nullptr if there is none
+    int frameDurationEdit_; //counts the uses of the frame duration spin box, so only changes from the same one are merged
 
     unsigned int currentFrame_; //index of the current frame in frames_
     int currentFrameSize_; //number of rows (columns) of the current frame
     unsigned int currentPlaybackFrame_; //the index of the frame being played back in frames_
-    int currentPlaybackSpeed_; //number of milliseconds a frame should be displayed for in the animation window
+    int currentPlaybackSpeed_; //number of milliseconds a frame without a duration of its own is displayed for in the animation window
     QTimer playbackTimer_; //used to control how long each frame is displayed in the animation preview window
     QColor currentColor_; //color being used for pixels
+    QTimer strokeTimer_; //draws and saves the cells a stroke was dragged over, once per tick
+    vector<QPoint> strokeSamples_; //cells the mouse was dragged into since the last tick (x is the column, y is the row)
+    QPoint lastStrokeCell_; //last cell drawn by the stroke in progress, or (-1,-1) if there is none
+    DirtyRegion strokeCells_; //cells painted by the stroke in progress, which it does not paint over again
 
     //cursor images for the different tools that can be selected
     QCursor drawCursor_;
@@ -75,43 +105,65 @@ private:
     QPair<int, int> shapeCoords_; //coordinates of the first side of the shape (the first corner that is clicked on)
 
     const int MAX_FRAME_SIZE = 40; //maximum size of a frame in pixels (number of rows, number of columns leq MAX_FRAME_SIZE)
+    const int MAX_UNDO_MEGABYTES = 4096; //most memory the user can give the undo history
 
     void fillCells(int, int); // Performs a fill with the currently selected color
+    void recolorFrames(int row, int col); //fills (or replaces the color of) a cell in every frame the fill options cover, as one undo step
     void drawRect(int, int); //draws a rectangle (first int is the y coordinate, second int is the x coordinate of a click)
     void drawCircle(int, int); //draws a circle (first int is the y coordinate, second int is the x coordinate of a click)
-
-    void setFrameLabel(); //sets the label at the bottom that says which frame the user is on
+    void startShape(int row, int col); //remembers the first corner of a rectangle or circle and starts its preview
+    void rasterizeShape(Rasterizer& rasterizer, int row, int col) const; //adds the current tool's shape from the first corner to (row, col)
+    void previewShape(int row, int col); //shows the shape a click on (row, col) would draw over the edit canvas
+    void finishShape(int row, int col); //draws the shape from the first corner to (row, col) into the frame
+    Compositor brush() const; //how the current tool paints: its color and blend mode
+    void paintStroke(const vector<PixelSpan>& spans); //paints the cells of the spans the stroke in progress has not painted yet
+    void drawStrokeSamples(); //joins the cells of the stroke since the last tick with lines and paints them on the edit canvas
+
+    void setFrameLabel(); //sets the label at the bottom that says which frame the user is on, and shows that frame's duration and the number of frames the fill range can cover
+    void showFrameSize(int frameSize); //changes the frame size and shows it in the combo box and the edit canvas
+    void startGifExport(const QString& fileName); //exports the frames as a gif in the background (to the clipboard if fileName is empty)
+    void beginFileOperation(FileOperation operation, const QString& message); //shows the progress of a load, save or export and blocks starting another one
 
     void checkButton(Tool); // Highlights the button for the specified tool. All other tool buttons are unchecked
 
+    ProjectState projectState() const; //snapshot of the frames, current frame and frame size for the undo history
+    void recordProjectChange(const ProjectState& before); //adds a change to the frames or frame size to the undo history
+    void applyHistory(bool undo); //undoes (or redoes) one step of the history and shows the result
+
 public slots:
     void changeCellColor(int, int); //changes the color of the cell to the currently selected color
     void changeNumberOfPixels(int); //changes the number of pixels in the frame
     void changeAlpha(int); //changes the opacity of the pixels the user draws
+    void changeFillScope(int scope); //chooses which frames the fill tool changes (0 this frame, 1 a range, 2 all of them)
     void createNewFrame(); //creates a new frame in the sprite animation sequence
     void duplicateFrame(); //creates a new frame in the sprite animation sequence with the same content as the previous frame
     void goToNextFrame(); //lets the user advance to the next frame to edit it
     void goToPreviousFrame(); //lets the user edit the previous frame in the aniimation sequence
-    void displayUndoFrame(); //change the current frame to the last framesForUndo
-    void displayRedoFrame(); //change the current frame to the last framesForRedo
+    void displayUndoFrame(); //undoes the last operation
+    void displayRedoFrame(); //redoes the last undone operation
     void changePlaybackSpeed(int newFPS); //changes the speed of the preview based on the input frames per second
+    void changeFrameDuration(int duration); //changes how long the current frame is shown, in milliseconds (0 for the playback speed)
+    void finishFrameDurationEdit(); //ends a use of the frame duration spin box, so the next change is undone on its own
     void updatePreview(); //updates the frame in the preview window
     void deleteFrame(); //called when the delete frame button is pressed, deletes the current frame
     void saveProject(); //saves the current project with help from the model
     void loadProject(); //loads the current project with help from the model
+    void copyGifToClipboard(); //puts the animation on the clipboard as a gif
+    void exportSpriteSheet(); //saves the frames packed into one png, with a json file of where each frame is
+    void changeUndoHistorySize(); //asks the user how much memory the undo history may keep and remembers it
 
 
 public:
-    void populateWithWidgetItems(QTableWidget* table); //initially populates the table widget with table widget items
     void saveCurrentFrame(); //saves the current frame
-    void saveFramesForUndo(); //saves the changes in frame for undo
-    void saveFramesForRedo(); //saves the changes in frame for redo
-    void loadFrame(QTableWidget* table, int frameIndex); //loads the current frame into the specified table
-    void loadPreviewFrame(QTableWidget* table, int frameIndex); //loads the full current frame into the preview table
+    void commitDirtyPixels(); //copies only the pixels changed in the edit canvas into the frames
+    void beginEdit(); //starts recording an operation for the undo history
+    void endEdit(); //finishes the operation being recorded and adds it to the undo history
+    void loadFrame(PixelCanvas* canvas, int frameIndex); //loads the current frame into the specified canvas
+    void loadPreviewFrame(PixelCanvas* canvas, int frameIndex); //loads the full current frame into the preview canvas
 
 
 signals:
-    void saveProjectSignal(vector<Frame*> frames, int currentFrameSize, QString fileName); //emitted to the model to save a  project
+    void saveProjectSignal(vector<Frame> frames, int currentFrameSize, QString fileName); //emitted to the model to save a  project
     void loadProjectSignal(QString fileName); //emitted to the model to load a project. the model calls finishLoadedProject when it is done
 
 private slots:
@@ -120,6 +172,9 @@ private slots:
     void on_eraseToolButton_clicked(); // Changes the current tool the eraser tool
     void onCellClicked(int, int); // Called when a cell is clicked on so that it can be edited with the appropriate tool
     void onCellEntered(int, int); // Called when a cell is entered so that it can be edited with the appropriate tool
+    void onCellHovered(int row, int col); // Called when the mouse moves to a cell with no button held, to move the preview of a shape
+    void onStrokeFinished(); // Called when the mouse is released so that the operation becomes one undo step
+    void flushStroke(); // Called on each tick of the stroke timer to draw and save the cells the stroke passed through
     void on_gifButton_clicked(); // Called when the user clicks on the "Export to Gif" button
     void on_currentColorTab_clicked(); // Called when the user clicks on the color button to change the color
     void on_currentColorTab_pressed(); // Called when the user clicks on the color button to change the color
@@ -127,7 +182,12 @@ private slots:
     void on_circleToolButton_clicked(); // Called when the user clicks on the create circle tool
 
     void fileFailedToOpen(QString error); //called when a file failed to open during save or load
-    void finishLoadingProject(vector<Frame*>); //called when the loaded project needs to be displayed
+    void finishLoadingProject(vector<Frame>, int); //called when the loaded project needs to be displayed
+    void showFileProgress(int completed, int total); //called as frames are loaded, saved or exported
+    void finishFileOperation(); //called when a load, save or export ends, hides its progress
+    void cancelFileOperation(); //called when the user cancels the load, save or export in progress
+    void finishGifExport(); //called when the background GIF export ends
+    void finishSpriteSheetExport(); //called when the background sprite sheet export ends
 };
 
 #endif // VIEW_H